@@ -30,12 +30,27 @@ struct ndn_name {
     uint16_t len;
 };
 
+/* Name cache sizing
+ * Keys are 64-bit hashes of the raw encoded name rather than the full
+ * struct ndn_name, so the same memory budget holds 64x the entries and
+ * lookups hash 8 bytes instead of 258. */
+#define NAME_CACHE_ENTRIES 65536
+#define NAME_VERIFY_LEN 32
+
+/* Cache entry: timestamp plus a stored name prefix so 64-bit hash
+ * collisions can be detected at lookup time */
+struct name_cache_entry {
+    uint64_t timestamp;
+    uint16_t name_len;
+    uint8_t name_prefix[NAME_VERIFY_LEN];
+};
+
 /* Forward declaration for the name cache map */
 struct {
     __uint(type, BPF_MAP_TYPE_LRU_HASH);
-    __uint(max_entries, 1024);
-    __type(key, struct ndn_name);
-    __type(value, int);
+    __uint(max_entries, NAME_CACHE_ENTRIES);
+    __type(key, uint64_t);  /* 64-bit name hash */
+    __type(value, struct name_cache_entry);
 } name_cache SEC(".maps");
 
 /* Forward declaration for the redirect map for interest forwarding */
@@ -46,6 +61,28 @@ struct {
     __type(value, uint32_t);
 } redirect_map SEC(".maps");
 
+/* Downstream face group for Data fan-out
+ * One ingress Data frame is replicated to every member interface with
+ * bpf_redirect_map(BPF_F_BROADCAST) instead of being cloned and
+ * retransmitted from userspace. Managed by the loader's face-group API. */
+#define FACE_GROUP_MAX 32
+
+struct {
+    __uint(type, BPF_MAP_TYPE_DEVMAP_HASH);
+    __uint(max_entries, FACE_GROUP_MAX);
+    __type(key, uint32_t);    /* Member ifindex */
+    __type(value, uint32_t);  /* Member ifindex */
+} face_group SEC(".maps");
+
+/* Member count, so the data path skips the broadcast when no group is
+ * configured */
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, uint32_t);
+} face_group_size SEC(".maps");
+
 /* Forward declaration for the interface info map */
 struct {
     __uint(type, BPF_MAP_TYPE_ARRAY);
@@ -64,8 +101,10 @@ struct ndn_stats {
     uint64_t cache_misses;
 };
 
+/* Per-CPU so every RX queue increments its own slot instead of bouncing
+ * one shared cacheline between cores; userspace sums the slots on read */
 struct {
-    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
     __uint(max_entries, 1);
     __type(key, uint32_t);
     __type(value, struct ndn_stats);
@@ -29,7 +29,11 @@
 #define TLV_SELECTORS 0x09
 #define TLV_CONTENT 0x15
 
-/* NDN header parsing helper functions */
+/* NDN header parsing helper functions
+ *
+ * These __always_inline walkers serve the BPF parser, which cannot use
+ * the SIMD userspace library. Userspace tools use ndn_tlv_lib.h
+ * (libndntlv) instead of copying these. */
 static __always_inline uint8_t parse_tlv_type(const void *data, uint16_t *offset)
 {
     uint8_t type = *(uint8_t *)((char *)data + *offset);
@@ -41,17 +41,36 @@ static void bump_memlock_rlimit(void)
     }
 }
 
+// Upper bound for per-CPU map reads
+#define MAX_CPUS 128
+
 // Print statistics from the stats_map
+// The map is per-CPU, so one lookup returns a slot per possible CPU;
+// summing them here keeps the reporting interface unchanged
 static void print_stats(int map_fd)
 {
+    struct ndn_stats percpu[MAX_CPUS];
     struct ndn_stats stats = {0};
     uint32_t key = 0;
+    int ncpus = libbpf_num_possible_cpus();
+
+    if (ncpus > MAX_CPUS)
+        ncpus = MAX_CPUS;
 
-    if (bpf_map_lookup_elem(map_fd, &key, &stats) != 0) {
+    if (bpf_map_lookup_elem(map_fd, &key, percpu) != 0) {
         fprintf(stderr, "Failed to read statistics\n");
         return;
     }
 
+    for (int i = 0; i < ncpus; i++) {
+        stats.interests_received += percpu[i].interests_received;
+        stats.interests_forwarded += percpu[i].interests_forwarded;
+        stats.data_received += percpu[i].data_received;
+        stats.data_forwarded += percpu[i].data_forwarded;
+        stats.cache_hits += percpu[i].cache_hits;
+        stats.cache_misses += percpu[i].cache_misses;
+    }
+
     printf("\nNDN XDP Statistics:\n");
     printf("  Interests received: %llu\n", stats.interests_received);
     printf("  Interests forwarded: %llu\n", stats.interests_forwarded);
@@ -73,12 +92,73 @@ static int setup_redirect(int redirect_map_fd, int from_ifindex, int to_ifindex)
     return 0;
 }
 
+// Face-group management
+// The face_group devmap lists every downstream interface subscribed to
+// Data fan-out; the XDP program broadcasts one ingress Data frame to
+// all of them (BPF_F_BROADCAST, ingress excluded). face_group_size
+// mirrors the member count so the data path can skip empty groups.
+
+// Recount the group members and publish the size for the data path
+static int face_group_sync_size(int group_fd, int size_fd)
+{
+    uint32_t key = 0, next_key;
+    uint32_t count = 0;
+    uint32_t slot = 0;
+    uint32_t *prev = NULL;
+
+    while (bpf_map_get_next_key(group_fd, prev, &next_key) == 0) {
+        count++;
+        key = next_key;
+        prev = &key;
+    }
+
+    if (bpf_map_update_elem(size_fd, &slot, &count, BPF_ANY)) {
+        fprintf(stderr, "Failed to update face group size: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return (int)count;
+}
+
+// Subscribe an interface to the Data fan-out group
+static int face_group_add(int group_fd, int size_fd, uint32_t member_ifindex)
+{
+    if (bpf_map_update_elem(group_fd, &member_ifindex, &member_ifindex, BPF_ANY)) {
+        fprintf(stderr, "Failed to add interface %u to face group: %s\n",
+                member_ifindex, strerror(errno));
+        return -1;
+    }
+
+    if (face_group_sync_size(group_fd, size_fd) < 0)
+        return -1;
+
+    printf("Added interface %u to the Data fan-out group\n", member_ifindex);
+    return 0;
+}
+
+// Unsubscribe an interface from the Data fan-out group
+static int face_group_remove(int group_fd, int size_fd, uint32_t member_ifindex)
+{
+    if (bpf_map_delete_elem(group_fd, &member_ifindex) && errno != ENOENT) {
+        fprintf(stderr, "Failed to remove interface %u from face group: %s\n",
+                member_ifindex, strerror(errno));
+        return -1;
+    }
+
+    if (face_group_sync_size(group_fd, size_fd) < 0)
+        return -1;
+
+    printf("Removed interface %u from the Data fan-out group\n", member_ifindex);
+    return 0;
+}
+
 static void usage(const char *prog)
 {
     printf("Usage: %s [OPTIONS]\n"
            "Options:\n"
            "  -i, --interface=<ifname>   Name of interface to attach XDP program\n"
            "  -r, --redirect=<ifname>    Name of interface to redirect traffic to\n"
+           "  -g, --group=<ifname>       Add interface to the Data fan-out group (repeatable)\n"
            "  -s, --skb-mode             Install XDP program in SKB (generic) mode\n"
            "  -h, --help                 Show this help\n",
            prog);
@@ -89,6 +169,10 @@ int main(int argc, char **argv)
     struct ndn_parser_xdp_bpf *skel;
     char ifname[IF_NAMESIZE] = "";
     char redirect_ifname[IF_NAMESIZE] = "";
+    char group_ifnames[FACE_GROUP_MAX][IF_NAMESIZE];
+    uint32_t group_members[FACE_GROUP_MAX] = {0};
+    int group_count = 0;
+    int group_map_fd = -1, group_size_fd = -1;
     int redirect_ifindex = 0;
     int stats_map_fd, redirect_map_fd;
     int err;
@@ -97,13 +181,14 @@ int main(int argc, char **argv)
     struct option long_options[] = {
         {"interface", required_argument, NULL, 'i'},
         {"redirect", required_argument, NULL, 'r'},
+        {"group", required_argument, NULL, 'g'},
         {"skb-mode", no_argument, NULL, 's'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "i:r:sh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "i:r:g:sh", long_options, NULL)) != -1) {
         switch (opt) {
         case 'i':
             strncpy(ifname, optarg, IF_NAMESIZE - 1);
@@ -111,6 +196,16 @@ int main(int argc, char **argv)
         case 'r':
             strncpy(redirect_ifname, optarg, IF_NAMESIZE - 1);
             break;
+        case 'g':
+            if (group_count >= FACE_GROUP_MAX) {
+                fprintf(stderr, "Error: face group is limited to %d interfaces\n",
+                        FACE_GROUP_MAX);
+                return EXIT_FAILURE;
+            }
+            strncpy(group_ifnames[group_count], optarg, IF_NAMESIZE - 1);
+            group_ifnames[group_count][IF_NAMESIZE - 1] = '\0';
+            group_count++;
+            break;
         case 's':
             xdp_flags &= ~XDP_FLAGS_DRV_MODE;
             xdp_flags |= XDP_FLAGS_SKB_MODE;
@@ -180,10 +275,11 @@ int main(int argc, char **argv)
     stats_map_fd = bpf_map__fd(skel->maps.stats_map);
     redirect_map_fd = bpf_map__fd(skel->maps.redirect_map);
     
-    // Initialize statistics
-    struct ndn_stats stats = {0};
+    // Initialize statistics (one zeroed slot per possible CPU)
+    struct ndn_stats zero_stats[MAX_CPUS];
     uint32_t key = 0;
-    bpf_map_update_elem(stats_map_fd, &key, &stats, BPF_ANY);
+    memset(zero_stats, 0, sizeof(zero_stats));
+    bpf_map_update_elem(stats_map_fd, &key, zero_stats, BPF_ANY);
 
     // Set up redirect if specified
     if (redirect_ifindex) {
@@ -192,6 +288,28 @@ int main(int argc, char **argv)
         }
     }
 
+    // Populate the Data fan-out group if specified
+    if (group_count > 0) {
+        group_map_fd = bpf_map__fd(skel->maps.face_group);
+        group_size_fd = bpf_map__fd(skel->maps.face_group_size);
+
+        for (int i = 0; i < group_count; i++) {
+            uint32_t member = if_nametoindex(group_ifnames[i]);
+            if (!member) {
+                fprintf(stderr, "Error: group interface '%s' not found\n",
+                        group_ifnames[i]);
+                err = -1;
+                goto cleanup;
+            }
+            if (face_group_add(group_map_fd, group_size_fd, member) != 0) {
+                err = -1;
+                goto cleanup;
+            }
+            group_members[i] = member;
+        }
+        printf("Data fan-out group configured with %d interface(s)\n", group_count);
+    }
+
     printf("NDN parser XDP program loaded and running.\n");
     printf("Press Ctrl+C to stop and view statistics.\n");
 
@@ -202,7 +320,13 @@ int main(int argc, char **argv)
     }
 
 cleanup:
-    // Clean up: detach XDP program and free resources
+    // Clean up: empty the fan-out group, detach the XDP program and free resources
+    if (group_map_fd >= 0) {
+        for (int i = 0; i < group_count; i++) {
+            if (group_members[i])
+                face_group_remove(group_map_fd, group_size_fd, group_members[i]);
+        }
+    }
     bpf_set_link_xdp_fd(ifindex, -1, xdp_flags);
     ndn_parser_xdp_bpf__destroy(skel);
     return err != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
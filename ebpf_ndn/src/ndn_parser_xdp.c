@@ -13,65 +13,84 @@
 
 char LICENSE[] SEC("license") = "GPL";
 
-// Helper function to parse NDN name from interest packet
-static __always_inline int parse_ndn_name(struct ndn_name *name, 
-                                         const void *data, 
-                                         uint16_t *offset, 
-                                         uint16_t name_length) {
-    // Initialize name
-    __builtin_memset(name->name, 0, MAX_NAME_LEN);
-    name->len = 0;
-    
-    uint16_t remaining = name_length;
-    uint16_t name_offset = 0;
-    
-    // Parse each name component
-    while (remaining > 0 && name->len < MAX_NAME_LEN - 1) {
-        // First byte is component type (should be 8 for regular components)
-        uint8_t comp_type = parse_tlv_type(data, offset);
-        if (comp_type != TLV_COMPONENT) {
-            // Skip unknown component types
-            uint16_t comp_len = parse_tlv_length(data, offset);
-            *offset += comp_len;
-            remaining -= (comp_len + 2); // type + length + value
-            continue;
-        }
-        
-        // Get component length
-        uint16_t comp_len = parse_tlv_length(data, offset);
-        if (comp_len == 0) {
-            // Empty component
-            remaining -= 2; // type + length
-            continue;
-        }
-        
-        // Add / separator between components
-        if (name->len > 0) {
-            name->name[name->len++] = '/';
-        }
-        
-        // Copy component value to name buffer
-        uint16_t copy_len = comp_len;
-        if (name->len + comp_len >= MAX_NAME_LEN) {
-            // Truncate if too long
-            copy_len = MAX_NAME_LEN - name->len - 1;
-        }
-        
-        __builtin_memcpy(&name->name[name->len], (char *)data + *offset, copy_len);
-        name->len += copy_len;
-        
-        // Update offsets
-        *offset += comp_len;
-        remaining -= (comp_len + 2); // type + length + value
+// Hash the raw encoded name bytes (xxhash-style, as in ndn_xdp.c)
+// Working directly on the name TLV value in the packet avoids the old
+// per-packet copy into a 256-byte struct ndn_name stack buffer.
+static __always_inline uint64_t hash_name_bytes(const uint8_t *name, uint16_t len,
+                                                void *data_end) {
+    const uint64_t PRIME64_1 = 11400714785074694791ULL;
+    const uint64_t PRIME64_2 = 14029467366897019727ULL;
+    const uint64_t PRIME64_3 = 1609587929392839161ULL;
+    const uint64_t PRIME64_5 = 2870177450012600261ULL;
+    uint64_t h64 = PRIME64_5;
+
+    // Process 8-byte blocks, bounded for the verifier at the same
+    // MAX_NAME_LEN span the old stack buffer held - every byte of a
+    // cacheable name is mixed in, so two names can only share a key
+    // through a genuine 64-bit collision
+    #pragma unroll
+    for (int i = 0; i < MAX_NAME_LEN / 8; i++) {
+        if ((uint16_t)((i + 1) * 8) > len)
+            break;
+        if ((void *)(name + (i * 8) + 8) > data_end)
+            break;
+
+        uint64_t k1 = *(uint64_t *)(name + (i * 8));
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
     }
-    
-    return 0;
+
+    // Mix in trailing bytes (< 8) one at a time
+    #pragma unroll
+    for (int i = 0; i < 8; i++) {
+        uint16_t pos = (len & ~7) + i;
+        if (pos >= len)
+            break;
+        if ((void *)(name + pos + 1) > data_end)
+            break;
+
+        h64 ^= (uint64_t)name[pos] * PRIME64_5;
+        h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
+    }
+
+    // Finalization
+    h64 += len;
+    h64 ^= h64 >> 33;
+    h64 *= PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME64_3;
+    h64 ^= h64 >> 32;
+
+    return h64;
+}
+
+// Verify a cache entry against the name on the wire so 64-bit hash
+// collisions are treated as misses rather than false hits
+static __always_inline int name_cache_verify(const struct name_cache_entry *entry,
+                                             const uint8_t *name, uint16_t len,
+                                             void *data_end) {
+    if (entry->name_len != len)
+        return 0;
+
+    #pragma unroll
+    for (int i = 0; i < NAME_VERIFY_LEN; i++) {
+        if (i >= len)
+            break;
+        if ((void *)(name + i + 1) > data_end)
+            return 0;
+        if (entry->name_prefix[i] != name[i])
+            return 0;
+    }
+
+    return 1;
 }
 
 // Helper function to update statistics
+// stats_map is per-CPU, so the lookup returns this CPU's private slot
+// and plain increments are safe without atomics
 static __always_inline void update_stats(int key, void *map, int stat_type) {
     struct ndn_stats *stats;
-    
+
     stats = bpf_map_lookup_elem(map, &key);
     if (!stats)
         return;
@@ -96,8 +115,6 @@ static __always_inline void update_stats(int key, void *map, int stat_type) {
             stats->cache_misses++;
             break;
     }
-    
-    bpf_map_update_elem(map, &key, stats, BPF_ANY);
 }
 
 SEC("xdp")
@@ -165,27 +182,46 @@ int ndn_parser_xdp_func(struct xdp_md *ctx) {
         
         if (field_type == TLV_NAME) {
             uint16_t name_len = parse_tlv_length(ndn_start, &pkt_offset);
-            
-            // Parse the NDN name
-            struct ndn_name name_key;
-            parse_ndn_name(&name_key, ndn_start, &pkt_offset, name_len);
-            
-            // Check if name is in cache
-            int *cache_entry = bpf_map_lookup_elem(&name_cache, &name_key);
-            
-            if (cache_entry) {
+
+            // Hash the raw encoded name directly from the packet
+            const uint8_t *name_start = (uint8_t *)ndn_start + pkt_offset;
+            if ((void *)(name_start + name_len) > data_end)
+                break;
+
+            // Names longer than the hashed span would alias on their
+            // uncovered middle bytes - leave them out of the dedup
+            // cache and let userspace handle them
+            if (name_len > MAX_NAME_LEN)
+                break;
+
+            uint64_t name_hash = hash_name_bytes(name_start, name_len, data_end);
+
+            // Check if name is in cache (with collision verification)
+            struct name_cache_entry *cached = bpf_map_lookup_elem(&name_cache, &name_hash);
+
+            if (cached && name_cache_verify(cached, name_start, name_len, data_end)) {
                 // Cache hit - we've seen this interest before
                 update_stats(key, &stats_map, 4); // Cache hit
-                
+
                 // Drop packet (avoid duplicate interests)
                 return XDP_DROP;
             } else {
-                // Cache miss - new interest
+                // Cache miss (or hash collision) - new interest
                 update_stats(key, &stats_map, 5); // Cache miss
-                
+
                 // Add to cache
-                int value = 1; // Just a placeholder value
-                bpf_map_update_elem(&name_cache, &name_key, &value, BPF_ANY);
+                struct name_cache_entry entry = {};
+                entry.timestamp = bpf_ktime_get_ns();
+                entry.name_len = name_len;
+                #pragma unroll
+                for (int i = 0; i < NAME_VERIFY_LEN; i++) {
+                    if (i >= name_len)
+                        break;
+                    if ((void *)(name_start + i + 1) > data_end)
+                        break;
+                    entry.name_prefix[i] = name_start[i];
+                }
+                bpf_map_update_elem(&name_cache, &name_hash, &entry, BPF_ANY);
                 
                 // Check if we should redirect to another interface
                 uint32_t ifindex = ctx->ingress_ifindex;
@@ -20,10 +20,20 @@
 #define MAX_NAME_LEN 256
 #define NDN_DEFAULT_PORT 6363
 
-// Name structure for map keys
-struct ndn_name {
-    char name[MAX_NAME_LEN];
-    __u16 len;
+// Name cache parameters
+// Keys are 64-bit hashes of the raw encoded name (the design proven by
+// the ebpf_xdp v2 parser) instead of the full 258-byte struct ndn_name,
+// so the same memory budget holds 64x the entries and every lookup
+// hashes 8 bytes instead of 258.
+#define NAME_CACHE_ENTRIES 65536
+#define NAME_VERIFY_LEN 32
+
+// Cache entry: timestamp plus a stored name prefix so 64-bit hash
+// collisions can be detected at lookup time
+struct name_cache_entry {
+    __u64 timestamp;
+    __u16 name_len;
+    __u8 name_prefix[NAME_VERIFY_LEN];
 };
 
 // Statistics tracking structure
@@ -40,9 +50,9 @@ struct ndn_stats {
 // Map definitions
 struct {
     __uint(type, BPF_MAP_TYPE_LRU_HASH);
-    __uint(max_entries, 1024);
-    __type(key, struct ndn_name);
-    __type(value, __u64);  // Timestamp
+    __uint(max_entries, NAME_CACHE_ENTRIES);
+    __type(key, __u64);  // 64-bit name hash
+    __type(value, struct name_cache_entry);
 } name_cache SEC(".maps");
 
 struct {
@@ -52,9 +62,43 @@ struct {
     __type(value, __u32);  // Destination ifindex
 } redirect_map SEC(".maps");
 
+// Downstream face group for Data fan-out
+// bpf_redirect_map can only target one interface per packet, so Data
+// that had to reach several faces used to be cloned and retransmitted
+// from userspace - a full copy and several microseconds per replica.
+// With BPF_F_BROADCAST one ingress frame is replicated to every member
+// of this map inside the driver layer instead.
+#define FACE_GROUP_MAX 32
+
+struct {
+    __uint(type, BPF_MAP_TYPE_DEVMAP_HASH);
+    __uint(max_entries, FACE_GROUP_MAX);
+    __type(key, __u32);    // Member ifindex
+    __type(value, __u32);  // Member ifindex
+} face_group SEC(".maps");
+
+// Member count, maintained by the loader's face-group API, so the data
+// path can skip the broadcast entirely when no group is configured
 struct {
     __uint(type, BPF_MAP_TYPE_ARRAY);
     __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u32);
+} face_group_size SEC(".maps");
+
+#ifndef BPF_F_BROADCAST
+#define BPF_F_BROADCAST (1ULL << 3)
+#endif
+#ifndef BPF_F_EXCLUDE_INGRESS
+#define BPF_F_EXCLUDE_INGRESS (1ULL << 4)
+#endif
+
+// Per-CPU so every RX queue increments its own slot - a shared counter
+// cacheline bounces between cores at high packet rates. Userspace sums
+// the slots on read.
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
     __type(key, __u32);    // Always 0
     __type(value, struct ndn_stats);
 } stats_map SEC(".maps");
@@ -96,9 +140,11 @@ static __always_inline __u16 parse_tlv_length(const void *data, __u16 *offset, v
 }
 
 // Helper function to update stats
+// The lookup returns this CPU's private slot, so plain increments are
+// safe without atomics
 static __always_inline void update_stats(__u32 key, __u32 stat_type) {
     struct ndn_stats *stats;
-    
+
     stats = bpf_map_lookup_elem(&stats_map, &key);
     if (!stats)
         return;
@@ -128,74 +174,93 @@ static __always_inline void update_stats(__u32 key, __u32 stat_type) {
     }
 }
 
-// Parse NDN name from TLV buffer
-static __always_inline int parse_ndn_name(struct ndn_name *name, const void *data, 
-                                          __u16 *offset, __u16 name_length, void *data_end) {
-    // Initialize name
-    __builtin_memset(name->name, 0, MAX_NAME_LEN);
-    name->len = 0;
-    
-    __u16 remaining = name_length;
-    __u16 name_end = *offset + name_length;
-    
-    // Make sure we don't read past data_end
-    if ((void *)((__u8 *)data + name_end) > data_end)
-        return -1;
-    
-    // Parse each name component
-    while (remaining > 0 && name->len < MAX_NAME_LEN - 1 && *offset < name_end) {
-        // First byte is component type (should be 8 for regular components)
-        __u8 comp_type = parse_tlv_type(data, offset, data_end);
-        if (comp_type != TLV_COMPONENT) {
-            // Skip unknown component types
-            __u16 comp_len = parse_tlv_length(data, offset, data_end);
-            if (comp_len == 0 || (*offset) + comp_len > name_end)
-                return -1;
-                
-            *offset += comp_len;
-            remaining -= (comp_len + 2); // type + length + value
-            continue;
-        }
-        
-        // Get component length
-        __u16 comp_len = parse_tlv_length(data, offset, data_end);
-        if (comp_len == 0) {
-            // Empty component
-            remaining -= 2; // type + length
-            continue;
-        }
-        
-        // Make sure we don't read past data_end
-        if ((void *)((__u8 *)data + *offset + comp_len) > data_end)
-            return -1;
-        
-        // Add / separator between components
-        if (name->len > 0)
-            name->name[name->len++] = '/';
-        
-        // Copy component value to name buffer
-        __u16 copy_len = comp_len;
-        if (name->len + comp_len >= MAX_NAME_LEN)
-            copy_len = MAX_NAME_LEN - name->len - 1;
-        
-        // Use memcpy with explicit bound checking for verifier
-        #pragma unroll
-        for (int i = 0; i < MAX_NAME_LEN; i++) {
-            if (i >= copy_len)
-                break;
-            if (*offset + i >= name_end)
-                break;
-            
-            name->name[name->len + i] = *((__u8 *)data + *offset + i);
-        }
-        name->len += copy_len;
-        
-        // Update offsets
-        *offset += comp_len;
-        remaining -= (comp_len + 2); // type + length + value
+// Hash the raw encoded name bytes (xxhash-style, as in the v2 parser)
+// Works directly on the name TLV value in the packet, eliminating the
+// old per-packet copy into a 256-byte stack buffer.
+static __always_inline __u64 hash_name_bytes(const __u8 *name, __u16 len, void *data_end) {
+    const __u64 PRIME64_1 = 11400714785074694791ULL;
+    const __u64 PRIME64_2 = 14029467366897019727ULL;
+    const __u64 PRIME64_3 = 1609587929392839161ULL;
+    const __u64 PRIME64_5 = 2870177450012600261ULL;
+    __u64 h64 = PRIME64_5;
+
+    // Process 8-byte blocks, bounded for the verifier at the same
+    // MAX_NAME_LEN span the old stack buffer held - every byte of a
+    // cacheable name is mixed in, so two names can only share a key
+    // through a genuine 64-bit collision
+    #pragma unroll
+    for (int i = 0; i < MAX_NAME_LEN / 8; i++) {
+        if ((__u16)((i + 1) * 8) > len)
+            break;
+        if ((void *)(name + (i * 8) + 8) > data_end)
+            break;
+
+        __u64 k1 = *(__u64 *)(name + (i * 8));
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
+    }
+
+    // Mix in trailing bytes (< 8) one at a time
+    #pragma unroll
+    for (int i = 0; i < 8; i++) {
+        __u16 pos = (len & ~7) + i;
+        if (pos >= len)
+            break;
+        if ((void *)(name + pos + 1) > data_end)
+            break;
+
+        h64 ^= (__u64)name[pos] * PRIME64_5;
+        h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
+    }
+
+    // Finalization
+    h64 += len;
+    h64 ^= h64 >> 33;
+    h64 *= PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME64_3;
+    h64 ^= h64 >> 32;
+
+    return h64;
+}
+
+// Verify a cache entry against the name on the wire
+// Two names can collide on the 64-bit hash; compare the stored length
+// and name prefix so a collision is treated as a miss, not a false hit.
+static __always_inline int name_cache_verify(const struct name_cache_entry *entry,
+                                             const __u8 *name, __u16 len, void *data_end) {
+    if (entry->name_len != len)
+        return 0;
+
+    #pragma unroll
+    for (int i = 0; i < NAME_VERIFY_LEN; i++) {
+        if (i >= len)
+            break;
+        if ((void *)(name + i + 1) > data_end)
+            return 0;
+        if (entry->name_prefix[i] != name[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+// Build a cache entry for the name on the wire
+static __always_inline void name_cache_fill(struct name_cache_entry *entry,
+                                            const __u8 *name, __u16 len, void *data_end) {
+    entry->timestamp = bpf_ktime_get_ns();
+    entry->name_len = len;
+    __builtin_memset(entry->name_prefix, 0, NAME_VERIFY_LEN);
+
+    #pragma unroll
+    for (int i = 0; i < NAME_VERIFY_LEN; i++) {
+        if (i >= len)
+            break;
+        if ((void *)(name + i + 1) > data_end)
+            break;
+
+        entry->name_prefix[i] = name[i];
     }
-    
-    return 0;
 }
 
 SEC("xdp")
@@ -269,40 +334,44 @@ int ndn_xdp_func(struct xdp_md *ctx) {
                 __u16 name_len = parse_tlv_length(data + pkt_offset, &offset, data_end);
                 if (name_len == 0)
                     break;
-                
-                // Parse the NDN name
-                struct ndn_name name;
-                if (parse_ndn_name(&name, data + pkt_offset, &offset, name_len, data_end) < 0)
+
+                // Hash the raw encoded name directly from the packet
+                const __u8 *name_start = (__u8 *)data + pkt_offset + offset;
+                if ((void *)(name_start + name_len) > data_end)
                     break;
-                
-                // If name is empty, continue processing
-                if (name.len == 0)
+
+                // Names longer than the hashed span would alias on
+                // their uncovered middle bytes - leave them out of the
+                // dedup cache and let userspace handle them
+                if (name_len > MAX_NAME_LEN)
                     break;
-                
-                // Check if name is already in cache
-                __u64 *timestamp = bpf_map_lookup_elem(&name_cache, &name);
-                if (timestamp) {
+
+                __u64 name_hash = hash_name_bytes(name_start, name_len, data_end);
+
+                // Check if name is already in cache (with collision check)
+                struct name_cache_entry *cached = bpf_map_lookup_elem(&name_cache, &name_hash);
+                if (cached && name_cache_verify(cached, name_start, name_len, data_end)) {
                     // Cache hit - drop duplicate interest
                     update_stats(key, 5);  // Update cache hit stats
                     update_stats(key, 2);  // Update dropped interest stats
                     return XDP_DROP;
                 } else {
-                    // Cache miss - add to cache
+                    // Cache miss (or hash collision) - add to cache
                     update_stats(key, 6);  // Update cache miss stats
-                    
-                    // Add to cache with current ktime
-                    __u64 now = bpf_ktime_get_ns();
-                    bpf_map_update_elem(&name_cache, &name, &now, BPF_ANY);
-                    
+
+                    struct name_cache_entry entry;
+                    name_cache_fill(&entry, name_start, name_len, data_end);
+                    bpf_map_update_elem(&name_cache, &name_hash, &entry, BPF_ANY);
+
                     // Check if we should redirect to another interface
                     __u32 *target_if = bpf_map_lookup_elem(&redirect_map, &ifindex);
-                    
+
                     if (target_if && *target_if > 0) {
                         // Redirect to target interface
                         update_stats(key, 1); // Update forwarded interest stats
                         return bpf_redirect(*target_if, 0);
                     }
-                    
+
                     // No redirect configured, pass up to userspace
                     update_stats(key, 1); // Update forwarded interest stats
                     return XDP_PASS;
@@ -321,8 +390,18 @@ int ndn_xdp_func(struct xdp_md *ctx) {
     else if (tlv_type == TLV_DATA) {
         // Update stats for received data
         update_stats(key, 3);
-        
-        // Forward all DATA packets (no caching or filtering of data packets)
+
+        // Fan the Data out to every subscribed face in the driver
+        // layer. BPF_F_EXCLUDE_INGRESS keeps the frame off the face it
+        // arrived on, so a producer's own reply is not reflected back.
+        __u32 *members = bpf_map_lookup_elem(&face_group_size, &key);
+        if (members && *members > 0) {
+            update_stats(key, 4);
+            return bpf_redirect_map(&face_group, 0,
+                                    BPF_F_BROADCAST | BPF_F_EXCLUDE_INGRESS);
+        }
+
+        // No face group configured - forward via userspace as before
         update_stats(key, 4);
     }
     
@@ -24,9 +24,14 @@ struct ndn_stats {
     uint64_t cache_misses;
 };
 
-struct ndn_name {
-    char name[256];
-    uint16_t len;
+// Same as in ndn_xdp.c - keys are 64-bit name hashes, entries keep a
+// stored name prefix for collision verification
+#define NAME_VERIFY_LEN 32
+
+struct name_cache_entry {
+    uint64_t timestamp;
+    uint16_t name_len;
+    uint8_t name_prefix[NAME_VERIFY_LEN];
 };
 
 static int xdp_flags = XDP_FLAGS_UPDATE_IF_NOEXIST;
@@ -54,16 +59,36 @@ static void bump_rlimit(void) {
     }
 }
 
+// Upper bound for per-CPU map reads
+#define MAX_CPUS 128
+
 // Print statistics from the stats map
+// stats_map is per-CPU; one lookup returns a slot per possible CPU and
+// we sum them so the printed totals look the same as before
 static void print_stats(void) {
-    struct ndn_stats stats;
+    struct ndn_stats percpu[MAX_CPUS];
+    struct ndn_stats stats = {0};
     uint32_t key = 0;
-    
-    if (bpf_map_lookup_elem(stats_map_fd, &key, &stats)) {
+    int ncpus = libbpf_num_possible_cpus();
+
+    if (ncpus > MAX_CPUS)
+        ncpus = MAX_CPUS;
+
+    if (bpf_map_lookup_elem(stats_map_fd, &key, percpu)) {
         fprintf(stderr, "Error: failed to read statistics\n");
         return;
     }
-    
+
+    for (int i = 0; i < ncpus; i++) {
+        stats.interests_received += percpu[i].interests_received;
+        stats.interests_forwarded += percpu[i].interests_forwarded;
+        stats.interests_dropped += percpu[i].interests_dropped;
+        stats.data_received += percpu[i].data_received;
+        stats.data_forwarded += percpu[i].data_forwarded;
+        stats.cache_hits += percpu[i].cache_hits;
+        stats.cache_misses += percpu[i].cache_misses;
+    }
+
     printf("\nNDN XDP Statistics:\n");
     printf("  Interests received:  %llu\n", stats.interests_received);
     printf("  Interests forwarded: %llu\n", stats.interests_forwarded);
@@ -76,32 +101,42 @@ static void print_stats(void) {
 
 // Print cache entries (top 10)
 static void print_cache_entries(void) {
-    struct ndn_name key, next_key;
-    uint64_t value;
+    uint64_t key = 0, next_key;
+    struct name_cache_entry entry;
     int count = 0;
-    
+
     printf("\nNDN Name Cache (recent entries):\n");
-    
-    // Zero out the key for initial lookup
-    memset(&key, 0, sizeof(key));
-    
+
     // Loop through all cache entries
     while (bpf_map_get_next_key(name_cache_fd, &key, &next_key) == 0) {
-        if (bpf_map_lookup_elem(name_cache_fd, &next_key, &value) == 0) {
-            printf("  %s (timestamp: %llu)\n", next_key.name, value);
+        if (bpf_map_lookup_elem(name_cache_fd, &next_key, &entry) == 0) {
+            // The stored prefix is raw component TLV bytes; print the
+            // printable ones so names are still recognizable
+            char preview[NAME_VERIFY_LEN + 1];
+            int n = 0;
+            for (int i = 0; i < NAME_VERIFY_LEN && i < entry.name_len; i++) {
+                uint8_t c = entry.name_prefix[i];
+                preview[n++] = (c >= 0x20 && c < 0x7f) ? c : '.';
+            }
+            preview[n] = '\0';
+
+            printf("  0x%016llx [%s%s] (len %u, timestamp: %llu)\n",
+                   (unsigned long long)next_key, preview,
+                   entry.name_len > NAME_VERIFY_LEN ? "..." : "",
+                   entry.name_len, (unsigned long long)entry.timestamp);
             count++;
         }
-        
+
         // Store this key for the next iteration
-        memcpy(&key, &next_key, sizeof(key));
-        
+        key = next_key;
+
         // Only show 10 entries
         if (count >= 10) {
             printf("  ... (and more)\n");
             break;
         }
     }
-    
+
     if (count == 0) {
         printf("  <empty>\n");
     }
@@ -119,12 +154,13 @@ static int setup_redirect(uint32_t from_ifindex, uint32_t to_ifindex) {
     return 0;
 }
 
-// Initialize stats map
+// Initialize stats map (one zeroed slot per possible CPU)
 static void init_stats_map(void) {
-    struct ndn_stats stats = {0};
+    struct ndn_stats zero_stats[MAX_CPUS];
     uint32_t key = 0;
-    
-    bpf_map_update_elem(stats_map_fd, &key, &stats, BPF_ANY);
+
+    memset(zero_stats, 0, sizeof(zero_stats));
+    bpf_map_update_elem(stats_map_fd, &key, zero_stats, BPF_ANY);
 }
 
 // Usage information
@@ -0,0 +1,649 @@
+//
+// NDN high-rate traffic generator
+//
+// Multi-threaded load generator for stressing the XDP path. Each worker
+// thread owns an AF_PACKET TX ring (with a plain sendto() fallback when
+// the ring can't be set up) and its own sequence space, and emits a
+// configurable mix of Interest and Data packets whose names are drawn
+// from a Zipf popularity distribution - so content store hit rates and
+// PIT behavior can be benchmarked under realistic skew instead of the
+// single-name stream generate_ndn_packets.c produces.
+//
+// The TLV construction follows generate_ndn_packets.c.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+
+// NDN TLV types (same set as generate_ndn_packets.c, plus Data)
+#define TLV_INTEREST 0x05
+#define TLV_DATA 0x06
+#define TLV_NAME 0x07
+#define TLV_COMPONENT 0x08
+#define TLV_NONCE 0x0A
+#define TLV_INTEREST_LIFETIME 0x0C
+#define TLV_METAINFO 0x14
+#define TLV_CONTENT 0x15
+#define TLV_FRESHNESS_PERIOD 0x19
+
+// NDN default UDP port
+#define NDN_DEFAULT_PORT 6363
+
+#define MAX_PACKET_SIZE 1500
+#define MAX_NAME_LEN 256
+#define MAX_THREADS 64
+#define MAX_COMPONENTS 16
+
+// TX ring geometry per thread
+#define RING_FRAME_SIZE 2048
+#define RING_FRAME_COUNT 4096
+#define RING_BLOCK_SIZE (1 << 22)
+#define TX_BATCH 64
+
+// Generator configuration (set from the command line, read-only after
+// startup)
+static struct {
+    const char *ifname;
+    uint8_t dst_mac[ETH_ALEN];
+    uint8_t src_mac[ETH_ALEN];
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t dst_port;
+    int threads;
+    uint32_t catalog_size;    // Number of distinct names
+    double zipf_exponent;     // 0 = uniform
+    int interest_ratio;       // Interests per (interests + data)
+    int data_ratio;
+    int components;           // Name components per packet
+    int component_len;        // Bytes per filler component
+    uint32_t content_size;    // Data packet content bytes
+    int duration;             // Seconds, 0 = until interrupted
+} cfg = {
+    .dst_port = NDN_DEFAULT_PORT,
+    .threads = 4,
+    .catalog_size = 100000,
+    .zipf_exponent = 1.0,
+    .interest_ratio = 9,
+    .data_ratio = 1,
+    .components = 4,
+    .component_len = 8,
+    .content_size = 256,
+    .duration = 10,
+};
+
+// Zipf cumulative distribution over the name catalog, shared by all
+// threads (built once, then read-only)
+static double *zipf_cdf;
+
+static volatile int keep_running = 1;
+
+// Per-thread worker state
+struct worker {
+    pthread_t thread;
+    int id;
+    int sockfd;
+    uint8_t *ring;           // mmap'd TX ring, NULL in sendto fallback
+    uint32_t ring_frames;
+    uint32_t next_frame;
+    uint64_t rng_state;      // xorshift64 state
+    uint32_t seq;            // Per-thread sequence space
+    uint64_t sent;           // Packets handed to the kernel
+    uint64_t dropped;        // Frames the kernel rejected
+};
+
+static struct worker workers[MAX_THREADS];
+
+static void int_exit(int sig) {
+    (void)sig;
+    keep_running = 0;
+}
+
+// Fast per-thread PRNG (xorshift64)
+static inline uint64_t rng_next(struct worker *w) {
+    uint64_t x = w->rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    w->rng_state = x;
+    return x;
+}
+
+// Build the Zipf CDF for the configured catalog and exponent
+static int build_zipf_cdf(void) {
+    double sum = 0;
+
+    zipf_cdf = malloc(cfg.catalog_size * sizeof(double));
+    if (!zipf_cdf)
+        return -1;
+
+    for (uint32_t i = 0; i < cfg.catalog_size; i++) {
+        sum += 1.0 / pow((double)(i + 1), cfg.zipf_exponent);
+        zipf_cdf[i] = sum;
+    }
+
+    // Normalize to [0, 1]
+    for (uint32_t i = 0; i < cfg.catalog_size; i++)
+        zipf_cdf[i] /= sum;
+
+    return 0;
+}
+
+// Draw a name rank from the Zipf distribution (binary search over the
+// CDF; rank 0 is the most popular name)
+static inline uint32_t zipf_draw(struct worker *w) {
+    double u = (double)(rng_next(w) >> 11) / (double)(1ULL << 53);
+    uint32_t lo = 0, hi = cfg.catalog_size - 1;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (zipf_cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Encode a name for the given rank into component TLVs
+// Layout: /bench/<filler components>/obj<rank> - the filler components
+// exercise the configured component count/length, the final component
+// carries the identity that drives cache behavior.
+static uint32_t encode_name(uint8_t *ptr, struct worker *w, uint32_t rank) {
+    uint32_t offset = 0;
+    char last[32];
+    int last_len;
+    int fillers = cfg.components - 2;
+
+    if (fillers < 0)
+        fillers = 0;
+
+    // Leading "bench" component
+    ptr[offset++] = TLV_COMPONENT;
+    ptr[offset++] = 5;
+    memcpy(ptr + offset, "bench", 5);
+    offset += 5;
+
+    // Filler components with pseudo-random printable bytes
+    for (int c = 0; c < fillers; c++) {
+        ptr[offset++] = TLV_COMPONENT;
+        ptr[offset++] = cfg.component_len;
+        for (int i = 0; i < cfg.component_len; i++)
+            ptr[offset++] = 'a' + ((rank + c + i) % 26);
+    }
+
+    // Identity component
+    last_len = snprintf(last, sizeof(last), "obj%u", rank);
+    ptr[offset++] = TLV_COMPONENT;
+    ptr[offset++] = last_len;
+    memcpy(ptr + offset, last, last_len);
+    offset += last_len;
+
+    (void)w;
+    return offset;
+}
+
+// Create an NDN Interest for the given rank (same structure as
+// create_ndn_interest in generate_ndn_packets.c, short-form lengths)
+static uint32_t create_interest(uint8_t *buffer, struct worker *w, uint32_t rank) {
+    uint32_t offset = 0;
+    uint8_t *ptr = buffer;
+
+    ptr[offset++] = TLV_INTEREST;
+    uint32_t interest_length_pos = offset;
+    offset++;
+
+    ptr[offset++] = TLV_NAME;
+    uint32_t name_length_pos = offset;
+    offset++;
+
+    uint32_t name_len = encode_name(ptr + offset, w, rank);
+    offset += name_len;
+    ptr[name_length_pos] = name_len;
+
+    // Nonce from the per-thread sequence space so no two threads ever
+    // collide on a nonce
+    uint32_t nonce = ((uint32_t)w->id << 24) | (w->seq++ & 0xFFFFFF);
+    ptr[offset++] = TLV_NONCE;
+    ptr[offset++] = 4;
+    memcpy(ptr + offset, &nonce, sizeof(nonce));
+    offset += sizeof(nonce);
+
+    // Interest lifetime: 4 seconds
+    uint16_t lifetime = htons(4000);
+    ptr[offset++] = TLV_INTEREST_LIFETIME;
+    ptr[offset++] = 2;
+    memcpy(ptr + offset, &lifetime, sizeof(lifetime));
+    offset += sizeof(lifetime);
+
+    ptr[interest_length_pos] = offset - interest_length_pos - 1;
+    return offset;
+}
+
+// Create an NDN Data packet for the given rank
+static uint32_t create_data(uint8_t *buffer, struct worker *w, uint32_t rank) {
+    uint32_t offset = 0;
+    uint8_t *ptr = buffer;
+    uint32_t content_size = cfg.content_size;
+
+    ptr[offset++] = TLV_DATA;
+
+    // Data packets carry content, so use the 2-byte extended length form
+    uint32_t data_length_pos = offset;
+    ptr[offset++] = 0xFD;
+    offset += 2;
+
+    ptr[offset++] = TLV_NAME;
+    uint32_t name_length_pos = offset;
+    offset++;
+
+    uint32_t name_len = encode_name(ptr + offset, w, rank);
+    offset += name_len;
+    ptr[name_length_pos] = name_len;
+
+    // MetaInfo with a freshness period
+    uint16_t freshness = htons(10000);
+    ptr[offset++] = TLV_METAINFO;
+    ptr[offset++] = 4;
+    ptr[offset++] = TLV_FRESHNESS_PERIOD;
+    ptr[offset++] = 2;
+    memcpy(ptr + offset, &freshness, sizeof(freshness));
+    offset += sizeof(freshness);
+
+    // Content block filled with a per-rank byte pattern
+    ptr[offset++] = TLV_CONTENT;
+    ptr[offset++] = 0xFD;
+    ptr[offset++] = content_size >> 8;
+    ptr[offset++] = content_size & 0xFF;
+    memset(ptr + offset, 'A' + (rank % 26), content_size);
+    offset += content_size;
+
+    uint16_t data_len = offset - data_length_pos - 3;
+    ptr[data_length_pos + 1] = data_len >> 8;
+    ptr[data_length_pos + 2] = data_len & 0xFF;
+
+    return offset;
+}
+
+// IP header checksum (same as generate_ndn_packets.c)
+static uint16_t ip_checksum(void *vdata, size_t length) {
+    uint16_t *data = vdata;
+    uint32_t sum = 0;
+
+    while (length > 1) {
+        sum += *data++;
+        length -= 2;
+    }
+    if (length == 1)
+        sum += *(uint8_t *)data;
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return ~sum;
+}
+
+// Build a complete Ethernet/IP/UDP frame around an NDN payload
+static uint32_t build_frame(uint8_t *frame, struct worker *w) {
+    struct ethhdr *eth = (struct ethhdr *)frame;
+    struct iphdr *ip = (struct iphdr *)(frame + sizeof(*eth));
+    struct udphdr *udp = (struct udphdr *)((uint8_t *)ip + sizeof(*ip));
+    uint8_t *payload = (uint8_t *)udp + sizeof(*udp);
+    uint32_t rank = zipf_draw(w);
+    uint32_t ndn_len;
+
+    // Interest:Data mix
+    int is_interest = (int)(rng_next(w) % (uint64_t)(cfg.interest_ratio + cfg.data_ratio))
+                      < cfg.interest_ratio;
+    if (is_interest)
+        ndn_len = create_interest(payload, w, rank);
+    else
+        ndn_len = create_data(payload, w, rank);
+
+    memcpy(eth->h_dest, cfg.dst_mac, ETH_ALEN);
+    memcpy(eth->h_source, cfg.src_mac, ETH_ALEN);
+    eth->h_proto = htons(ETH_P_IP);
+
+    ip->version = 4;
+    ip->ihl = 5;
+    ip->tos = 0;
+    ip->tot_len = htons(sizeof(*ip) + sizeof(*udp) + ndn_len);
+    ip->id = htons(w->seq & 0xFFFF);
+    ip->frag_off = 0;
+    ip->ttl = 64;
+    ip->protocol = IPPROTO_UDP;
+    ip->saddr = cfg.src_ip;
+    ip->daddr = cfg.dst_ip;
+    ip->check = 0;
+    ip->check = ip_checksum(ip, sizeof(*ip));
+
+    // Vary the source port across the thread's sequence space so RSS
+    // spreads the load over the receiver's RX queues
+    udp->source = htons(10000 + ((w->id << 8) | (w->seq & 0xFF)));
+    udp->dest = htons(cfg.dst_port);
+    udp->len = htons(sizeof(*udp) + ndn_len);
+    udp->check = 0;  // Optional over IPv4
+
+    return sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + ndn_len;
+}
+
+// Set up an AF_PACKET TX ring for one worker
+// Returns 0 on success; on failure the worker falls back to sendto()
+static int worker_ring_setup(struct worker *w, int ifindex) {
+    struct tpacket_req req = {
+        .tp_block_size = RING_BLOCK_SIZE,
+        .tp_frame_size = RING_FRAME_SIZE,
+    };
+    struct sockaddr_ll addr = {0};
+    int version = TPACKET_V2;
+
+    req.tp_frame_nr = RING_FRAME_COUNT;
+    req.tp_block_nr = (RING_FRAME_COUNT * RING_FRAME_SIZE) / RING_BLOCK_SIZE;
+
+    if (setsockopt(w->sockfd, SOL_PACKET, PACKET_VERSION,
+                   &version, sizeof(version)) < 0)
+        return -1;
+
+    if (setsockopt(w->sockfd, SOL_PACKET, PACKET_TX_RING,
+                   &req, sizeof(req)) < 0)
+        return -1;
+
+    w->ring = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+                   PROT_READ | PROT_WRITE, MAP_SHARED, w->sockfd, 0);
+    if (w->ring == MAP_FAILED) {
+        w->ring = NULL;
+        return -1;
+    }
+    w->ring_frames = req.tp_frame_nr;
+    w->next_frame = 0;
+
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = 0;  // TX only
+    addr.sll_ifindex = ifindex;
+
+    if (bind(w->sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        munmap(w->ring, (size_t)req.tp_block_size * req.tp_block_nr);
+        w->ring = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Worker main loop: fill a batch of ring frames, kick the kernel once
+// per batch, repeat
+static void *worker_main(void *arg) {
+    struct worker *w = (struct worker *)arg;
+    struct sockaddr_ll addr = {0};
+    uint8_t frame_buf[MAX_PACKET_SIZE];
+
+    addr.sll_family = AF_PACKET;
+    addr.sll_ifindex = if_nametoindex(cfg.ifname);
+    addr.sll_halen = ETH_ALEN;
+    memcpy(addr.sll_addr, cfg.dst_mac, ETH_ALEN);
+
+    while (keep_running) {
+        if (w->ring) {
+            int queued = 0;
+
+            for (int i = 0; i < TX_BATCH; i++) {
+                struct tpacket2_hdr *hdr = (struct tpacket2_hdr *)
+                    (w->ring + (size_t)w->next_frame * RING_FRAME_SIZE);
+
+                if (hdr->tp_status != TP_STATUS_AVAILABLE)
+                    break;
+
+                uint8_t *data = (uint8_t *)hdr +
+                    TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+                hdr->tp_len = build_frame(data, w);
+                __sync_synchronize();
+                hdr->tp_status = TP_STATUS_SEND_REQUEST;
+
+                w->next_frame = (w->next_frame + 1) % w->ring_frames;
+                queued++;
+            }
+
+            if (queued > 0) {
+                int ret = sendto(w->sockfd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+                if (ret < 0 && errno != EAGAIN && errno != ENOBUFS)
+                    w->dropped += queued;
+                else
+                    w->sent += queued;
+            } else {
+                // Ring full - the kernel is draining; don't spin hot
+                sendto(w->sockfd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+            }
+        } else {
+            // sendto fallback path
+            uint32_t len = build_frame(frame_buf, w);
+            int ret = sendto(w->sockfd, frame_buf, len, 0,
+                             (struct sockaddr *)&addr, sizeof(addr));
+            if (ret < 0)
+                w->dropped++;
+            else
+                w->sent++;
+        }
+    }
+
+    return NULL;
+}
+
+static int parse_mac(const char *str, uint8_t *mac) {
+    return sscanf(str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+                  &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == 6 ? 0 : -1;
+}
+
+static void print_usage(const char *progname) {
+    printf("Usage: %s -i IFACE -m DST_MAC [OPTIONS]\n", progname);
+    printf("Options:\n");
+    printf("  -i IFACE      Interface to transmit on (required)\n");
+    printf("  -m MAC        Destination MAC address (required)\n");
+    printf("  -S IP         Source IP address (default: 10.0.0.1)\n");
+    printf("  -D IP         Destination IP address (default: 10.0.0.2)\n");
+    printf("  -p PORT       Destination UDP port (default: %d)\n", NDN_DEFAULT_PORT);
+    printf("  -T THREADS    Worker threads (default: 4)\n");
+    printf("  -N NAMES      Name catalog size (default: 100000)\n");
+    printf("  -z EXPONENT   Zipf exponent, 0 = uniform (default: 1.0)\n");
+    printf("  -R I:D        Interest:Data ratio (default: 9:1)\n");
+    printf("  -C COUNT      Name components per packet (default: 4)\n");
+    printf("  -l LEN        Filler component length in bytes (default: 8)\n");
+    printf("  -s SIZE       Data content size in bytes (default: 256)\n");
+    printf("  -t SECONDS    Run duration, 0 = until Ctrl+C (default: 10)\n");
+    printf("  -h            Print this help message\n");
+}
+
+int main(int argc, char **argv) {
+    const char *src_ip_str = "10.0.0.1";
+    const char *dst_ip_str = "10.0.0.2";
+    int have_mac = 0;
+    int ifindex;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:m:S:D:p:T:N:z:R:C:l:s:t:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            cfg.ifname = optarg;
+            break;
+        case 'm':
+            if (parse_mac(optarg, cfg.dst_mac) != 0) {
+                fprintf(stderr, "Invalid MAC address: %s\n", optarg);
+                return 1;
+            }
+            have_mac = 1;
+            break;
+        case 'S':
+            src_ip_str = optarg;
+            break;
+        case 'D':
+            dst_ip_str = optarg;
+            break;
+        case 'p':
+            cfg.dst_port = (uint16_t)atoi(optarg);
+            break;
+        case 'T':
+            cfg.threads = atoi(optarg);
+            if (cfg.threads < 1 || cfg.threads > MAX_THREADS) {
+                fprintf(stderr, "Threads must be 1..%d\n", MAX_THREADS);
+                return 1;
+            }
+            break;
+        case 'N':
+            cfg.catalog_size = (uint32_t)atol(optarg);
+            break;
+        case 'z':
+            cfg.zipf_exponent = atof(optarg);
+            break;
+        case 'R':
+            if (sscanf(optarg, "%d:%d", &cfg.interest_ratio, &cfg.data_ratio) != 2 ||
+                cfg.interest_ratio < 0 || cfg.data_ratio < 0 ||
+                cfg.interest_ratio + cfg.data_ratio == 0) {
+                fprintf(stderr, "Invalid ratio: %s (expected I:D)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            cfg.components = atoi(optarg);
+            if (cfg.components < 2 || cfg.components > MAX_COMPONENTS) {
+                fprintf(stderr, "Components must be 2..%d\n", MAX_COMPONENTS);
+                return 1;
+            }
+            break;
+        case 'l':
+            cfg.component_len = atoi(optarg);
+            if (cfg.component_len < 1 || cfg.component_len > 64) {
+                fprintf(stderr, "Component length must be 1..64\n");
+                return 1;
+            }
+            break;
+        case 's':
+            cfg.content_size = (uint32_t)atoi(optarg);
+            if (cfg.content_size > 1024) {
+                fprintf(stderr, "Content size must be <= 1024\n");
+                return 1;
+            }
+            break;
+        case 't':
+            cfg.duration = atoi(optarg);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!cfg.ifname || !have_mac) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ifindex = if_nametoindex(cfg.ifname);
+    if (!ifindex) {
+        fprintf(stderr, "Interface '%s' not found\n", cfg.ifname);
+        return 1;
+    }
+
+    if (inet_pton(AF_INET, src_ip_str, &cfg.src_ip) != 1 ||
+        inet_pton(AF_INET, dst_ip_str, &cfg.dst_ip) != 1) {
+        fprintf(stderr, "Invalid IP address\n");
+        return 1;
+    }
+
+    // Pick a locally administered source MAC
+    cfg.src_mac[0] = 0x02;
+    for (int i = 1; i < ETH_ALEN; i++)
+        cfg.src_mac[i] = (uint8_t)(0x10 + i);
+
+    if (build_zipf_cdf() != 0) {
+        fprintf(stderr, "Failed to build Zipf distribution\n");
+        return 1;
+    }
+
+    signal(SIGINT, int_exit);
+    signal(SIGTERM, int_exit);
+
+    printf("NDN traffic generator: %d threads, %u names, zipf %.2f, ratio %d:%d\n",
+           cfg.threads, cfg.catalog_size, cfg.zipf_exponent,
+           cfg.interest_ratio, cfg.data_ratio);
+
+    // Start workers
+    for (int t = 0; t < cfg.threads; t++) {
+        struct worker *w = &workers[t];
+
+        w->id = t;
+        w->rng_state = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)t << 32) ^ time(NULL);
+        w->seq = 0;
+
+        w->sockfd = socket(AF_PACKET, SOCK_RAW, 0);
+        if (w->sockfd < 0) {
+            perror("socket(AF_PACKET)");
+            return 1;
+        }
+
+        if (worker_ring_setup(w, ifindex) != 0) {
+            fprintf(stderr, "Thread %d: TX ring unavailable (%s), using sendto fallback\n",
+                    t, strerror(errno));
+        }
+
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    // Report aggregate rate once a second
+    uint64_t prev_total = 0;
+    int elapsed = 0;
+    while (keep_running && (cfg.duration == 0 || elapsed < cfg.duration)) {
+        sleep(1);
+        elapsed++;
+
+        uint64_t total = 0, dropped = 0;
+        for (int t = 0; t < cfg.threads; t++) {
+            total += workers[t].sent;
+            dropped += workers[t].dropped;
+        }
+
+        printf("  %d s: %lu pps (total %lu sent, %lu dropped)\n",
+               elapsed, (unsigned long)(total - prev_total),
+               (unsigned long)total, (unsigned long)dropped);
+        prev_total = total;
+    }
+    keep_running = 0;
+
+    uint64_t total = 0, dropped = 0;
+    for (int t = 0; t < cfg.threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        total += workers[t].sent;
+        dropped += workers[t].dropped;
+        close(workers[t].sockfd);
+    }
+
+    printf("Done: %lu packets sent, %lu dropped, %.1f Mpps average\n",
+           (unsigned long)total, (unsigned long)dropped,
+           elapsed > 0 ? (double)total / elapsed / 1e6 : 0);
+
+    free(zipf_cdf);
+    return 0;
+}
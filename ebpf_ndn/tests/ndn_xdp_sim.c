@@ -8,46 +8,93 @@
 #include <linux/udp.h>
 #include <sys/time.h>
 #include <pcap/pcap.h>
+#include <pthread.h>
 #include <signal.h>
 #include <inttypes.h>
 
-// NDN TLV types
-#define TLV_INTEREST 0x05
-#define TLV_DATA 0x06
-#define TLV_NACK 0x03
-#define TLV_NAME 0x07
-#define TLV_COMPONENT 0x08
-#define TLV_NONCE 0x0A
+// Shared bounds-checked TLV parsing (libndntlv) - replaces the scalar
+// parse_tlv_type/parse_tlv_length walkers this simulator used to carry
+#include "../include/ndn_tlv_lib.h"
 
 // NDN parameters
 #define MAX_NAME_LEN 256
 #define MAX_CACHE_ENTRIES 1024
 #define NDN_DEFAULT_PORT 6363
 
+// Cache geometry: open-addressing table sized at 4x the entry budget to
+// keep the load factor low, with a bounded linear probe run
+#define CACHE_TABLE_SIZE (MAX_CACHE_ENTRIES * 4)
+#define CACHE_PROBE_LIMIT 8
+
+// Name pool: slab-backed size classes instead of fixed 256-byte slots
+#define POOL_SLAB_SIZE (64 * 1024)
+#define POOL_NUM_CLASSES 4
+
+// Replay sharding
+#define MAX_SHARDS 16
+#define SHARD_QUEUE_SIZE 1024
+#define SHARD_SLOT_SIZE 2048
+
 // Forward declarations
 struct ndn_name {
     char name[MAX_NAME_LEN];
     uint16_t len;
 };
 
-// Simplified LRU cache for NDN names
-struct ndn_cache_entry {
-    struct ndn_name name;
+// One slot of the hash-indexed name cache. The name bytes live in the
+// shard's pool; the 64-bit hash filters almost all probes before the
+// memcmp verify.
+struct ndn_cache_slot {
+    uint64_t hash;
     uint64_t timestamp;
+    char *name;        // Pool-allocated, not NUL-terminated
+    uint16_t len;
     int valid;
 };
 
+// Slab/pool allocator for name bytes. Allocations round up to a size
+// class; evicted names go back on the class free list, and backing
+// slabs are only ever grown, never returned.
+struct name_pool {
+    void *free_lists[POOL_NUM_CLASSES];  // First word of a free chunk links to the next
+    uint8_t *slab_cursor;
+    size_t slab_remaining;
+};
+
+// Per-shard simulator state. In replay mode each worker thread owns one
+// shard exclusively (packets are routed by name hash), so no locking is
+// needed on the cache, pool or counters.
+struct sim_shard {
+    struct ndn_cache_slot cache[CACHE_TABLE_SIZE];
+    int cache_size;
+    struct name_pool pool;
+    uint64_t stats_interests_received;
+    uint64_t stats_interests_forwarded;
+    uint64_t stats_data_received;
+    uint64_t stats_data_forwarded;
+    uint64_t stats_cache_hits;
+    uint64_t stats_cache_misses;
+};
+
+// Bounded packet queue feeding one replay worker
+struct shard_queue {
+    uint8_t slots[SHARD_QUEUE_SIZE][SHARD_SLOT_SIZE];
+    uint32_t lens[SHARD_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    int done;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
 // Global variables
-static struct ndn_cache_entry name_cache[MAX_CACHE_ENTRIES];
-static int cache_next_idx = 0;
-static int cache_size = 0;
+static struct sim_shard *shards;
+static struct shard_queue *queues;
+static pthread_t shard_threads[MAX_SHARDS];
+static int num_shards = 1;
+static int verbose = 1;
 static volatile int keep_running = 1;
-static uint64_t stats_interests_received = 0;
-static uint64_t stats_interests_forwarded = 0;
-static uint64_t stats_data_received = 0;
-static uint64_t stats_data_forwarded = 0;
-static uint64_t stats_cache_hits = 0;
-static uint64_t stats_cache_misses = 0;
 
 // Get current timestamp in milliseconds
 static uint64_t get_timestamp_ms() {
@@ -58,126 +105,169 @@ static uint64_t get_timestamp_ms() {
 
 // Signal handler for graceful termination
 static void signal_handler(int sig) {
+    (void)sig;
     keep_running = 0;
 }
 
-// Helper function to parse TLV type
-static uint8_t parse_tlv_type(const void *data, uint16_t *offset) {
-    uint8_t type = *(uint8_t *)((char *)data + *offset);
-    (*offset)++;
-    return type;
+// xxHash64 over a byte buffer. Same constants and block structure as
+// the xxhash in ebpf_xdp/ndn_parser_v2.c, minus the verifier-driven
+// bounds checks and unroll limits that don't apply in userspace.
+static uint64_t xxhash64(const uint8_t *data, uint32_t length, uint64_t seed) {
+    const uint64_t PRIME64_1 = 11400714785074694791ULL;
+    const uint64_t PRIME64_2 = 14029467366897019727ULL;
+    const uint64_t PRIME64_4 = 9650029242287828579ULL;
+    const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+    uint64_t h64 = seed + PRIME64_5;
+    uint32_t block_count = length / 8;
+
+    for (uint32_t i = 0; i < block_count; i++) {
+        uint64_t k1;
+        memcpy(&k1, data + (i * 8), sizeof(k1));
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
+        h64 = h64 * PRIME64_1 + PRIME64_4;
+    }
+
+    for (uint32_t i = block_count * 8; i < length; i++) {
+        h64 ^= data[i] * PRIME64_5;
+        h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
+    }
+
+    h64 += length;
+
+    // Final avalanche
+    h64 ^= h64 >> 33;
+    h64 *= PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME64_1;
+    h64 ^= h64 >> 32;
+
+    return h64;
 }
 
-// Helper function to parse TLV length
-static uint16_t parse_tlv_length(const void *data, uint16_t *offset) {
-    uint8_t first_byte = *(uint8_t *)((char *)data + *offset);
-    (*offset)++;
-    
-    /* Check if this is a short form (< 253) */
-    if (first_byte < 253) {
-        return first_byte;
-    }
-    
-    /* Medium length (2 bytes) */
-    if (first_byte == 253) {
-        uint16_t length = *(uint16_t *)((char *)data + *offset);
-        (*offset) += 2;
-        return (length >> 8) | ((length & 0xff) << 8); // Convert from network to host byte order
-    }
-    
-    /* Long length not supported in this implementation */
-    return 0;
+// Pool size classes: 32/64/128/256 bytes
+static size_t pool_class_size(int class) {
+    return 32u << class;
+}
+
+static int pool_class_for(size_t len) {
+    for (int c = 0; c < POOL_NUM_CLASSES; c++) {
+        if (len <= pool_class_size(c))
+            return c;
+    }
+    return -1;
+}
+
+// Allocate name storage from the pool
+static char *pool_alloc(struct name_pool *pool, size_t len) {
+    int class = pool_class_for(len);
+    if (class < 0)
+        return NULL;
+
+    // Reuse a freed chunk of this class if one is available
+    if (pool->free_lists[class]) {
+        void *chunk = pool->free_lists[class];
+        memcpy(&pool->free_lists[class], chunk, sizeof(void *));
+        return chunk;
+    }
+
+    // Carve a fresh chunk off the current slab
+    size_t size = pool_class_size(class);
+    if (pool->slab_remaining < size) {
+        pool->slab_cursor = malloc(POOL_SLAB_SIZE);
+        if (!pool->slab_cursor)
+            return NULL;
+        pool->slab_remaining = POOL_SLAB_SIZE;
+    }
+
+    char *chunk = (char *)pool->slab_cursor;
+    pool->slab_cursor += size;
+    pool->slab_remaining -= size;
+    return chunk;
 }
 
-// Parse NDN name from TLV buffer
-static int parse_ndn_name(struct ndn_name *name, const void *data, uint16_t *offset, uint16_t name_length) {
-    // Initialize name
+// Return name storage to the pool's free list
+static void pool_free(struct name_pool *pool, char *chunk, size_t len) {
+    int class = pool_class_for(len);
+    if (class < 0)
+        return;
+    memcpy(chunk, &pool->free_lists[class], sizeof(void *));
+    pool->free_lists[class] = chunk;
+}
+
+// Render a parsed Name TLV value into the simulator's name struct
+// (URI-style, components joined with '/'), via libndntlv
+static void render_ndn_name(struct ndn_name *name, const uint8_t *value,
+                            uint32_t value_len) {
     memset(name->name, 0, MAX_NAME_LEN);
-    name->len = 0;
-    
-    uint16_t remaining = name_length;
-    
-    // Parse each name component
-    while (remaining > 0 && name->len < MAX_NAME_LEN - 1) {
-        // First byte is component type (should be 8 for regular components)
-        uint8_t comp_type = parse_tlv_type(data, offset);
-        if (comp_type != TLV_COMPONENT) {
-            // Skip unknown component types
-            uint16_t comp_len = parse_tlv_length(data, offset);
-            *offset += comp_len;
-            remaining -= (comp_len + 2); // type + length + value
-            continue;
-        }
-        
-        // Get component length
-        uint16_t comp_len = parse_tlv_length(data, offset);
-        if (comp_len == 0) {
-            // Empty component
-            remaining -= 2; // type + length
+    name->len = (uint16_t)ndntlv_name_to_uri(value, value_len,
+                                             name->name, MAX_NAME_LEN);
+}
+
+// Add an entry to a shard's name cache. Probes linearly from the hash
+// slot; if the whole probe run is occupied (or the shard is at its
+// entry budget) the oldest entry in the run is evicted, which
+// approximates the old LRU replacement without the full-table scan.
+static void cache_add(struct sim_shard *shard, struct ndn_name *name, uint64_t hash) {
+    uint32_t base = (uint32_t)(hash & (CACHE_TABLE_SIZE - 1));
+    int victim = -1;
+    uint64_t victim_time = UINT64_MAX;
+    int target = -1;
+
+    for (int i = 0; i < CACHE_PROBE_LIMIT; i++) {
+        uint32_t idx = (base + i) & (CACHE_TABLE_SIZE - 1);
+        struct ndn_cache_slot *slot = &shard->cache[idx];
+
+        if (!slot->valid) {
+            if (target < 0 && shard->cache_size < MAX_CACHE_ENTRIES)
+                target = idx;
             continue;
         }
-        
-        // Add / separator between components
-        if (name->len > 0) {
-            name->name[name->len++] = '/';
+        if (slot->timestamp < victim_time) {
+            victim_time = slot->timestamp;
+            victim = idx;
         }
-        
-        // Copy component value to name buffer
-        uint16_t copy_len = comp_len;
-        if (name->len + comp_len >= MAX_NAME_LEN) {
-            // Truncate if too long
-            copy_len = MAX_NAME_LEN - name->len - 1;
-        }
-        
-        memcpy(&name->name[name->len], (char *)data + *offset, copy_len);
-        name->len += copy_len;
-        
-        // Update offsets
-        *offset += comp_len;
-        remaining -= (comp_len + 2); // type + length + value
-    }
-    
-    return 0;
-}
+    }
 
-// Add an entry to the name cache
-static void cache_add(struct ndn_name *name) {
-    if (cache_size < MAX_CACHE_ENTRIES) {
-        // Cache is not full, add to next slot
-        name_cache[cache_next_idx].valid = 1;
-        strncpy(name_cache[cache_next_idx].name.name, name->name, MAX_NAME_LEN - 1);
-        name_cache[cache_next_idx].name.len = name->len;
-        name_cache[cache_next_idx].timestamp = get_timestamp_ms();
-        
-        cache_next_idx = (cache_next_idx + 1) % MAX_CACHE_ENTRIES;
-        cache_size++;
-    } else {
-        // Cache is full, replace oldest entry
-        int oldest_idx = 0;
-        uint64_t oldest_time = UINT64_MAX;
-        
-        for (int i = 0; i < MAX_CACHE_ENTRIES; i++) {
-            if (name_cache[i].valid && name_cache[i].timestamp < oldest_time) {
-                oldest_time = name_cache[i].timestamp;
-                oldest_idx = i;
-            }
-        }
-        
-        // Replace oldest entry
-        strncpy(name_cache[oldest_idx].name.name, name->name, MAX_NAME_LEN - 1);
-        name_cache[oldest_idx].name.len = name->len;
-        name_cache[oldest_idx].timestamp = get_timestamp_ms();
+    // No free slot usable: evict the oldest entry in the probe run
+    if (target < 0) {
+        if (victim < 0)
+            return;
+        struct ndn_cache_slot *slot = &shard->cache[victim];
+        pool_free(&shard->pool, slot->name, slot->len);
+        slot->valid = 0;
+        shard->cache_size--;
+        target = victim;
     }
+
+    struct ndn_cache_slot *slot = &shard->cache[target];
+    slot->name = pool_alloc(&shard->pool, name->len);
+    if (!slot->name)
+        return;
+    memcpy(slot->name, name->name, name->len);
+    slot->len = name->len;
+    slot->hash = hash;
+    slot->timestamp = get_timestamp_ms();
+    slot->valid = 1;
+    shard->cache_size++;
 }
 
-// Check if a name is in the cache
-static int cache_check(struct ndn_name *name) {
-    for (int i = 0; i < MAX_CACHE_ENTRIES; i++) {
-        if (name_cache[i].valid && 
-            name_cache[i].name.len == name->len && 
-            strncmp(name_cache[i].name.name, name->name, name->len) == 0) {
+// Check if a name is in a shard's cache. The hash comparison rejects
+// nearly every non-matching slot; the memcmp only runs on a 64-bit
+// collision.
+static int cache_check(struct sim_shard *shard, struct ndn_name *name, uint64_t hash) {
+    uint32_t base = (uint32_t)(hash & (CACHE_TABLE_SIZE - 1));
+
+    for (int i = 0; i < CACHE_PROBE_LIMIT; i++) {
+        uint32_t idx = (base + i) & (CACHE_TABLE_SIZE - 1);
+        struct ndn_cache_slot *slot = &shard->cache[idx];
+
+        if (slot->valid && slot->hash == hash &&
+            slot->len == name->len &&
+            memcmp(slot->name, name->name, name->len) == 0) {
             // Update timestamp for this entry (for LRU)
-            name_cache[i].timestamp = get_timestamp_ms();
+            slot->timestamp = get_timestamp_ms();
             return 1; // Found in cache
         }
     }
@@ -185,139 +275,214 @@ static int cache_check(struct ndn_name *name) {
 }
 
 // Process an NDN packet - the core of what the XDP program would do
-static int process_ndn_packet(const uint8_t *packet, uint32_t len, int *should_forward) {
+static int process_ndn_packet(struct sim_shard *shard, const uint8_t *packet,
+                              uint32_t len, int *should_forward) {
     // Default: forward the packet
     *should_forward = 1;
-    
-    uint16_t offset = 0;
-    
-    // Check if packet is long enough for a TLV type and length
-    if (len < 2) {
+
+    struct ndntlv_view view;
+    if (ndntlv_parse_packet(packet, len, &view) != 0)
         return -1;
-    }
-    
-    // Parse packet type
-    uint8_t tlv_type = parse_tlv_type(packet, &offset);
-    
+
     // For this simulation, we only handle Interest packets
-    if (tlv_type == TLV_INTEREST) {
-        stats_interests_received++;
-        
-        // Parse interest length
-        uint16_t interest_len = parse_tlv_length(packet, &offset);
-        
-        // Ensure packet is complete
-        if (offset + interest_len > len) {
-            return -1;
-        }
-        
-        // Find and parse Name TLV
-        uint16_t end_of_interest = offset + interest_len;
-        while (offset < end_of_interest) {
-            uint8_t field_type = parse_tlv_type(packet, &offset);
-            
-            if (field_type == TLV_NAME) {
-                uint16_t name_len = parse_tlv_length(packet, &offset);
-                
-                // Parse the NDN name
-                struct ndn_name name;
-                parse_ndn_name(&name, packet, &offset, name_len);
-                
-                printf("Received NDN Interest: %s\n", name.name);
-                
-                // Check if name is already in cache
-                if (cache_check(&name)) {
-                    stats_cache_hits++;
-                    printf("Cache HIT for %s - dropping duplicate interest\n", name.name);
-                    *should_forward = 0; // Don't forward (simulating XDP_DROP)
-                    return 0;
-                } else {
-                    stats_cache_misses++;
-                    printf("Cache MISS for %s - adding to cache and forwarding\n", name.name);
-                    // Add to cache
-                    cache_add(&name);
-                    stats_interests_forwarded++;
-                    return 0;
-                }
-            }
-            
-            // Skip this TLV field
-            uint16_t field_len = parse_tlv_length(packet, &offset);
-            offset += field_len;
+    if (view.pkt_type == NDNTLV_INTEREST) {
+        shard->stats_interests_received++;
+
+        // Render the NDN name
+        struct ndn_name name;
+        render_ndn_name(&name, view.name, view.name_len);
+
+        uint64_t hash = xxhash64((const uint8_t *)name.name, name.len, 0);
+
+        if (verbose)
+            printf("Received NDN Interest: %s\n", name.name);
+
+        // Check if name is already in cache
+        if (cache_check(shard, &name, hash)) {
+            shard->stats_cache_hits++;
+            if (verbose)
+                printf("Cache HIT for %s - dropping duplicate interest\n", name.name);
+            *should_forward = 0; // Don't forward (simulating XDP_DROP)
+            return 0;
+        } else {
+            shard->stats_cache_misses++;
+            if (verbose)
+                printf("Cache MISS for %s - adding to cache and forwarding\n", name.name);
+            // Add to cache
+            cache_add(shard, &name, hash);
+            shard->stats_interests_forwarded++;
+            return 0;
         }
-    } else if (tlv_type == TLV_DATA) {
+    } else if (view.pkt_type == NDNTLV_DATA) {
         // For Data packets, just count them
-        stats_data_received++;
-        stats_data_forwarded++;
+        shard->stats_data_received++;
+        shard->stats_data_forwarded++;
         return 0;
     }
-    
+
     return 0;
 }
 
-// Packet handler for libpcap
-static void packet_handler(uint8_t *user, const struct pcap_pkthdr *h, const uint8_t *bytes) {
+// Locate the NDN payload inside an Ethernet frame. Returns the payload
+// offset and length, or -1 for non-NDN traffic.
+static int extract_ndn_payload(const uint8_t *bytes, uint32_t len,
+                               uint32_t *payload_offset, uint32_t *payload_len) {
     // Check if the packet is large enough to be an Ethernet frame
-    if (h->len < sizeof(struct ethhdr)) {
-        return;
+    if (len < sizeof(struct ethhdr)) {
+        return -1;
     }
-    
+
     // Cast the packet to an Ethernet header
     const struct ethhdr *eth = (struct ethhdr *)bytes;
-    
+
     // Check if it's an IP packet
     if (ntohs(eth->h_proto) != ETH_P_IP) {
-        return;
+        return -1;
     }
-    
+
     // Check if packet is large enough to contain an IP header
-    if (h->len < sizeof(struct ethhdr) + sizeof(struct iphdr)) {
-        return;
+    if (len < sizeof(struct ethhdr) + sizeof(struct iphdr)) {
+        return -1;
     }
-    
+
     // Cast to an IP header
     const struct iphdr *ip = (struct iphdr *)(bytes + sizeof(struct ethhdr));
-    
+
     // Check if it's a UDP packet
     if (ip->protocol != IPPROTO_UDP) {
-        return;
+        return -1;
     }
-    
+
     // Check if packet is large enough to contain a UDP header
-    if (h->len < sizeof(struct ethhdr) + (ip->ihl * 4) + sizeof(struct udphdr)) {
-        return;
+    if (len < sizeof(struct ethhdr) + (ip->ihl * 4) + sizeof(struct udphdr)) {
+        return -1;
     }
-    
+
     // Cast to a UDP header
     const struct udphdr *udp = (struct udphdr *)(bytes + sizeof(struct ethhdr) + (ip->ihl * 4));
-    
+
     // Check if it's to/from NDN port
     if (ntohs(udp->dest) != NDN_DEFAULT_PORT && ntohs(udp->source) != NDN_DEFAULT_PORT) {
-        return;
+        return -1;
     }
-    
+
     // Calculate the UDP data offset and length
     uint32_t udp_data_offset = sizeof(struct ethhdr) + (ip->ihl * 4) + sizeof(struct udphdr);
-    uint32_t udp_data_len = h->len - udp_data_offset;
-    
+
     // Check if we have any UDP payload
-    if (udp_data_len == 0) {
+    if (len <= udp_data_offset) {
+        return -1;
+    }
+
+    *payload_offset = udp_data_offset;
+    *payload_len = len - udp_data_offset;
+    return 0;
+}
+
+// Pick the replay shard for an NDN payload by hashing the raw Name TLV
+// bytes, so all packets for a name land on the same worker and the
+// per-shard caches need no locking. Falls back to shard 0 when the
+// name can't be located.
+static int shard_for_payload(const uint8_t *payload, uint32_t len) {
+    struct ndntlv_view view;
+
+    if (num_shards == 1)
+        return 0;
+
+    if (ndntlv_parse_packet(payload, len, &view) != 0)
+        return 0;
+
+    return xxhash64(view.name, view.name_len, 0) % num_shards;
+}
+
+// Hand a packet payload to a shard's queue (blocks while the queue is full)
+static void queue_push(struct shard_queue *q, const uint8_t *data, uint32_t len) {
+    if (len > SHARD_SLOT_SIZE)
+        len = SHARD_SLOT_SIZE;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->tail - q->head == SHARD_QUEUE_SIZE && keep_running)
+        pthread_cond_wait(&q->not_full, &q->lock);
+
+    if (q->tail - q->head < SHARD_QUEUE_SIZE) {
+        uint32_t slot = q->tail % SHARD_QUEUE_SIZE;
+        memcpy(q->slots[slot], data, len);
+        q->lens[slot] = len;
+        q->tail++;
+        pthread_cond_signal(&q->not_empty);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Replay worker: drain this shard's queue through the NDN processor
+static void *shard_worker(void *arg) {
+    int id = (int)(long)arg;
+    struct shard_queue *q = &queues[id];
+    struct sim_shard *shard = &shards[id];
+    uint8_t packet[SHARD_SLOT_SIZE];
+    uint32_t len;
+    int should_forward;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->head == q->tail && !q->done)
+            pthread_cond_wait(&q->not_empty, &q->lock);
+
+        if (q->head == q->tail && q->done) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+
+        uint32_t slot = q->head % SHARD_QUEUE_SIZE;
+        len = q->lens[slot];
+        memcpy(packet, q->slots[slot], len);
+        q->head++;
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->lock);
+
+        process_ndn_packet(shard, packet, len, &should_forward);
+    }
+
+    return NULL;
+}
+
+// Packet handler for libpcap (live capture, single shard)
+static void packet_handler(uint8_t *user, const struct pcap_pkthdr *h, const uint8_t *bytes) {
+    (void)user;
+    uint32_t payload_offset, payload_len;
+
+    if (extract_ndn_payload(bytes, h->len, &payload_offset, &payload_len) < 0) {
         return;
     }
-    
+
     // Call our NDN packet processor - simulating the XDP functionality
     int should_forward;
-    process_ndn_packet(bytes + udp_data_offset, udp_data_len, &should_forward);
-    
+    process_ndn_packet(&shards[0], bytes + payload_offset, payload_len, &should_forward);
+
     // In real XDP, we would return XDP_PASS or XDP_DROP here. In this simulation,
     // we're just logging the decision.
-    if (should_forward) {
-        printf("Action: FORWARD packet\n");
-    } else {
-        printf("Action: DROP packet\n");
+    if (verbose) {
+        if (should_forward) {
+            printf("Action: FORWARD packet\n");
+        } else {
+            printf("Action: DROP packet\n");
+        }
+
+        printf("\n");
+    }
+}
+
+// Packet handler for offline replay: route to the owning shard's worker
+static void replay_handler(uint8_t *user, const struct pcap_pkthdr *h, const uint8_t *bytes) {
+    (void)user;
+    uint32_t payload_offset, payload_len;
+
+    if (extract_ndn_payload(bytes, h->len, &payload_offset, &payload_len) < 0) {
+        return;
     }
-    
-    printf("\n");
+
+    int shard = shard_for_payload(bytes + payload_offset, payload_len);
+    queue_push(&queues[shard], bytes + payload_offset, payload_len);
 }
 
 // Print usage information
@@ -325,40 +490,135 @@ static void print_usage(const char *progname) {
     printf("Usage: %s [OPTIONS]\n", progname);
     printf("Options:\n");
     printf("  -i INTERFACE   Specify the network interface to capture\n");
+    printf("  -r FILE        Replay a pcap file instead of live capture\n");
+    printf("  -T THREADS     Replay worker threads (default: 1, max: %d)\n", MAX_SHARDS);
     printf("  -f FILTER      Specify a pcap filter (default: udp port %d)\n", NDN_DEFAULT_PORT);
+    printf("  -v             Per-packet output during replay (on by default live)\n");
     printf("  -h             Print this help message\n");
 }
 
-// Print statistics
+// Print statistics (summed over all shards)
 static void print_stats() {
+    uint64_t interests_received = 0, interests_forwarded = 0;
+    uint64_t data_received = 0, data_forwarded = 0;
+    uint64_t cache_hits = 0, cache_misses = 0;
+    int cache_size = 0;
+
+    for (int i = 0; i < num_shards; i++) {
+        interests_received += shards[i].stats_interests_received;
+        interests_forwarded += shards[i].stats_interests_forwarded;
+        data_received += shards[i].stats_data_received;
+        data_forwarded += shards[i].stats_data_forwarded;
+        cache_hits += shards[i].stats_cache_hits;
+        cache_misses += shards[i].stats_cache_misses;
+        cache_size += shards[i].cache_size;
+    }
+
     printf("\nNDN XDP Simulation Statistics:\n");
     printf("-------------------------------\n");
-    printf("  Interests received:     %" PRIu64 "\n", stats_interests_received);
-    printf("  Interests forwarded:    %" PRIu64 "\n", stats_interests_forwarded);
-    printf("  Data packets received:  %" PRIu64 "\n", stats_data_received);
-    printf("  Data packets forwarded: %" PRIu64 "\n", stats_data_forwarded);
-    printf("  Name cache hits:        %" PRIu64 "\n", stats_cache_hits);
-    printf("  Name cache misses:      %" PRIu64 "\n", stats_cache_misses);
-    printf("  Name cache size:        %d/%d\n", cache_size, MAX_CACHE_ENTRIES);
+    printf("  Interests received:     %" PRIu64 "\n", interests_received);
+    printf("  Interests forwarded:    %" PRIu64 "\n", interests_forwarded);
+    printf("  Data packets received:  %" PRIu64 "\n", data_received);
+    printf("  Data packets forwarded: %" PRIu64 "\n", data_forwarded);
+    printf("  Name cache hits:        %" PRIu64 "\n", cache_hits);
+    printf("  Name cache misses:      %" PRIu64 "\n", cache_misses);
+    printf("  Name cache size:        %d/%d\n", cache_size, MAX_CACHE_ENTRIES * num_shards);
+}
+
+// Replay a pcap file across the worker shards
+static int run_replay(const char *pcap_file, char *filter) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t *handle;
+    struct bpf_program fp;
+    uint64_t start_ms, elapsed_ms;
+
+    handle = pcap_open_offline(pcap_file, errbuf);
+    if (handle == NULL) {
+        fprintf(stderr, "Error: Couldn't open pcap file %s: %s\n", pcap_file, errbuf);
+        return 2;
+    }
+
+    if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) == -1) {
+        fprintf(stderr, "Error: Couldn't parse filter %s: %s\n", filter, pcap_geterr(handle));
+        return 2;
+    }
+    if (pcap_setfilter(handle, &fp) == -1) {
+        fprintf(stderr, "Error: Couldn't install filter %s: %s\n", filter, pcap_geterr(handle));
+        return 2;
+    }
+
+    printf("NDN XDP Simulation (replay)\n");
+    printf("---------------------------\n");
+    printf("File: %s\n", pcap_file);
+    printf("Filter: %s\n", filter);
+    printf("Threads: %d\n\n", num_shards);
+
+    // Start the shard workers
+    for (int i = 0; i < num_shards; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+        pthread_cond_init(&queues[i].not_empty, NULL);
+        pthread_cond_init(&queues[i].not_full, NULL);
+        pthread_create(&shard_threads[i], NULL, shard_worker, (void *)(long)i);
+    }
+
+    start_ms = get_timestamp_ms();
+
+    // Drive the whole file through the shard queues
+    pcap_loop(handle, -1, replay_handler, NULL);
+
+    // Signal end of input and wait for the workers to drain
+    for (int i = 0; i < num_shards; i++) {
+        pthread_mutex_lock(&queues[i].lock);
+        queues[i].done = 1;
+        pthread_cond_broadcast(&queues[i].not_empty);
+        pthread_mutex_unlock(&queues[i].lock);
+    }
+    for (int i = 0; i < num_shards; i++) {
+        pthread_join(shard_threads[i], NULL);
+    }
+
+    elapsed_ms = get_timestamp_ms() - start_ms;
+    printf("Replay finished in %" PRIu64 ".%03" PRIu64 " s\n",
+           elapsed_ms / 1000, elapsed_ms % 1000);
+
+    print_stats();
+    pcap_close(handle);
+
+    return 0;
 }
 
 int main(int argc, char **argv) {
     char *interface = NULL;
+    char *pcap_file = NULL;
     char *filter = NULL;
     char errbuf[PCAP_ERRBUF_SIZE];
     pcap_t *handle;
     struct bpf_program fp;
+    int verbose_flag = -1;
     int opt;
-    
+
     // Parse command-line options
-    while ((opt = getopt(argc, argv, "i:f:h")) != -1) {
+    while ((opt = getopt(argc, argv, "i:r:T:f:vh")) != -1) {
         switch (opt) {
         case 'i':
             interface = optarg;
             break;
+        case 'r':
+            pcap_file = optarg;
+            break;
+        case 'T':
+            num_shards = atoi(optarg);
+            if (num_shards < 1 || num_shards > MAX_SHARDS) {
+                fprintf(stderr, "Error: Threads must be 1..%d\n", MAX_SHARDS);
+                return 1;
+            }
+            break;
         case 'f':
             filter = optarg;
             break;
+        case 'v':
+            verbose_flag = 1;
+            break;
         case 'h':
             print_usage(argv[0]);
             return 0;
@@ -367,41 +627,58 @@ int main(int argc, char **argv) {
             return 1;
         }
     }
-    
-    // Check if interface was provided
-    if (!interface) {
-        fprintf(stderr, "Error: Network interface must be specified.\n");
+
+    // Check if a packet source was provided
+    if (!interface && !pcap_file) {
+        fprintf(stderr, "Error: A network interface (-i) or pcap file (-r) must be specified.\n");
         print_usage(argv[0]);
         return 1;
     }
-    
+    if (interface && num_shards > 1) {
+        fprintf(stderr, "Error: -T only applies to pcap replay (-r).\n");
+        return 1;
+    }
+
+    // Per-packet output would dominate replay time, so it's opt-in there
+    verbose = (verbose_flag >= 0) ? verbose_flag : (pcap_file ? 0 : 1);
+
     // Set up filter if not provided
     if (!filter) {
         char default_filter[64];
         snprintf(default_filter, sizeof(default_filter), "udp port %d", NDN_DEFAULT_PORT);
         filter = default_filter;
     }
-    
-    // Initialize the name cache
-    memset(name_cache, 0, sizeof(name_cache));
-    
+
+    // Allocate and initialize the per-shard caches and queues
+    shards = calloc(num_shards, sizeof(*shards));
+    queues = calloc(num_shards, sizeof(*queues));
+    if (!shards || !queues) {
+        fprintf(stderr, "Error: Out of memory allocating shards.\n");
+        return 1;
+    }
+
     // Set up signal handler for graceful termination
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
-    
+
+    // Offline replay mode
+    if (pcap_file) {
+        return run_replay(pcap_file, filter);
+    }
+
     printf("NDN XDP Simulation\n");
     printf("-----------------\n");
     printf("Interface: %s\n", interface);
     printf("Filter: %s\n", filter);
     printf("Press Ctrl+C to stop and view statistics.\n\n");
-    
+
     // Open the network interface for packet capture
     handle = pcap_open_live(interface, BUFSIZ, 1, 1000, errbuf);
     if (handle == NULL) {
         fprintf(stderr, "Error: Couldn't open interface %s: %s\n", interface, errbuf);
         return 2;
     }
-    
+
     // Compile and set the filter
     if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) == -1) {
         fprintf(stderr, "Error: Couldn't parse filter %s: %s\n", filter, pcap_geterr(handle));
@@ -411,23 +688,23 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Error: Couldn't install filter %s: %s\n", filter, pcap_geterr(handle));
         return 2;
     }
-    
+
     // Start packet capture
     while (keep_running) {
         // Process one packet
         if (pcap_dispatch(handle, 1, packet_handler, NULL) < 0) {
             break;
         }
-        
+
         // Small sleep to prevent CPU hogging
         usleep(10000); // 10ms
     }
-    
+
     // Print statistics before exiting
     print_stats();
-    
+
     // Clean up
     pcap_close(handle);
-    
+
     return 0;
 }
@@ -0,0 +1,129 @@
+//
+// μDCN - Batched BPF map syscall helpers
+//
+// Shared by the userspace loaders (ndn_xdp_loader.c and
+// ndn_xdp_loader_v2.c). The polling loops used to issue one bpf()
+// syscall per map key per sweep; with per-CPU expansion and a 100ms
+// monitoring cadence that adds up to thousands of syscalls a second.
+// BPF_MAP_LOOKUP_BATCH / BPF_MAP_DELETE_BATCH bring each sweep down to
+// one (or a handful of) syscalls.
+//
+
+#ifndef NDN_MAP_BATCH_H
+#define NDN_MAP_BATCH_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+// Number of possible CPUs the kernel expands per-CPU map values to
+static inline int ndn_batch_num_cpus(void)
+{
+    int ncpus = libbpf_num_possible_cpus();
+
+    if (ncpus < 1)
+        ncpus = 1;
+
+    return ncpus;
+}
+
+// Read one batch of entries from a map in a single syscall.
+//
+// *batch_token carries the kernel's position cookie between calls; pass
+// NULL as prev_token on the first call and the same pointers on
+// subsequent calls to continue a sweep. On return *count holds the
+// number of entries actually copied out.
+//
+// Returns 0 when more entries remain, 1 when the sweep reached the end
+// of the map (entries may still have been copied), and -errno on error.
+static inline int ndn_map_lookup_batch(int map_fd, void *prev_token,
+                                       void *batch_token, void *keys,
+                                       void *values, __u32 *count)
+{
+    int err;
+
+    err = bpf_map_lookup_batch(map_fd, prev_token, batch_token,
+                               keys, values, count, NULL);
+    if (err == 0)
+        return 0;
+    if (errno == ENOENT)
+        return 1;  // End of map - *count entries are still valid
+
+    return -errno;
+}
+
+// Delete a set of keys in a single syscall
+static inline int ndn_map_delete_batch(int map_fd, void *keys, __u32 *count)
+{
+    int err;
+
+    err = bpf_map_delete_batch(map_fd, keys, count, NULL);
+    if (err && errno != ENOENT)
+        return -errno;
+
+    return 0;
+}
+
+// Update a set of key/value pairs in a single syscall
+static inline int ndn_map_update_batch(int map_fd, void *keys, void *values,
+                                       __u32 *count)
+{
+    int err;
+
+    err = bpf_map_update_batch(map_fd, keys, values, count, NULL);
+    if (err)
+        return -errno;
+
+    return 0;
+}
+
+// Collect a per-CPU array of counters (like the metrics map) in one
+// syscall and sum the per-CPU slots into sums[0..nmetrics-1].
+//
+// The kernel copies out num_possible_cpus slots per entry regardless of
+// what userspace expects, so the value buffer is sized from the real
+// possible-CPU count - allocated once, since that count is fixed for
+// the lifetime of the boot - and the same count is the summing stride.
+// A compile-time bound would misindex every entry (and overrun the
+// buffer) on machines with more possible CPUs than the bound.
+static inline int ndn_percpu_metrics_collect(int metrics_fd, __u64 *sums,
+                                             __u32 nmetrics)
+{
+    static __u64 *values;
+    __u32 keys[64];
+    __u32 count = nmetrics;
+    __u32 batch = 0;
+    int ncpus = ndn_batch_num_cpus();
+    int ret;
+
+    if (nmetrics > 64)
+        return -EINVAL;
+
+    if (!values) {
+        values = malloc(64 * (size_t)ncpus * sizeof(__u64));
+        if (!values)
+            return -ENOMEM;
+    }
+
+    memset(sums, 0, nmetrics * sizeof(__u64));
+
+    ret = ndn_map_lookup_batch(metrics_fd, NULL, &batch, keys, values, &count);
+    if (ret < 0)
+        return ret;
+
+    for (__u32 i = 0; i < count; i++) {
+        __u32 key = keys[i];
+
+        if (key >= nmetrics)
+            continue;
+
+        for (int cpu = 0; cpu < ncpus; cpu++)
+            sums[key] += values[i * ncpus + cpu];
+    }
+
+    return 0;
+}
+
+#endif /* NDN_MAP_BATCH_H */
@@ -0,0 +1,557 @@
+//
+// μDCN - Parser Micro-Benchmark Harness
+//
+// Loads each generation of the NDN XDP parser and drives it in the
+// kernel with BPF_PROG_TEST_RUN over a corpus of synthetic frames, so
+// per-packet cost can be compared across parser changes without a NIC
+// testbed. benchmark.py measures the system end to end; this measures
+// just the program, as average ns/packet over a large repetition count.
+//
+// Three generations are benchmarked:
+//   gen1  ebpf_ndn/src/ndn_xdp.c        (ndn_xdp_func)
+//   v1    ndn_parser.c                  (ndn_xdp_parser)
+//   v2    ndn_parser_v2[_proc].c        (ndn_xdp_parser_v2 + pipeline)
+//
+// The v2 attach point tail-calls through prog_stages, so the jump table
+// is wired exactly as the loader wires it; the reported duration covers
+// the whole chained pipeline, not just the classify stage.
+//
+// Per-name state written by a program (name cache, PIT, nonce filters,
+// content store) persists across repetitions of the one frame being
+// timed, so after the first iteration each class settles onto one
+// steady-state path (e.g. a repeated Interest exercises the duplicate
+// detection path, not PIT insertion). That steady-state figure is the
+// regression number; the class labels below name the path they settle on.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <linux/bpf.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+// NDN TLV definitions (packet types, stage indexes)
+#include "ndn_tlv.h"
+
+// Mirror of the framing constants in the parsers
+#define NDN_ETHERTYPE 0x8624  // NDN ethertype for direct Ethernet framing
+#define NDN_UDP_PORT  6363    // Standard NDN UDP port
+
+#define MAX_FRAME_SIZE   1500
+#define DEFAULT_REPEAT   100000
+
+// Default location of the first-generation object, relative to ebpf_xdp/
+// (built by the ebpf_ndn Makefile; see the microbench target)
+#define GEN1_OBJ_DEFAULT "../ebpf_ndn/build/ndn_xdp.o"
+
+static int repeat_count = DEFAULT_REPEAT;
+static const char *gen1_obj_path = GEN1_OBJ_DEFAULT;
+
+// One parser generation: object file plus entry program name
+struct parser_gen {
+    const char *label;
+    const char *path;
+    const char *prog_name;
+};
+
+// One corpus class: the frame under test plus an optional companion
+// frame run (untimed) beforehand to establish state - e.g. a Data frame
+// so the following Interest measures the cache-hit serve path.
+struct bench_case {
+    const char *label;
+    uint8_t frame[MAX_FRAME_SIZE];
+    uint32_t frame_len;
+    uint8_t warm_frame[MAX_FRAME_SIZE];
+    uint32_t warm_len;     // 0 = no companion frame
+    int expect_serve;      // Pipelined parser must answer with XDP_TX
+};
+
+// ---------------------------------------------------------------------
+// Synthetic packet construction (encoding as in
+// ebpf_ndn/tests/generate_ndn_packets.c: 1-byte TLV lengths throughout)
+// ---------------------------------------------------------------------
+
+// Helper function to calculate IP checksum
+static uint16_t ip_checksum(void *vdata, size_t length) {
+    uint16_t *data = vdata;
+    uint32_t sum = 0;
+
+    while (length > 1) {
+        sum += *data++;
+        length -= 2;
+    }
+    if (length == 1)
+        sum += *(uint8_t *)data;
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return ~sum;
+}
+
+// Encode the components of a name URI ("/foo/bar") as a Name TLV
+static uint32_t encode_name(uint8_t *ptr, const char *name_uri) {
+    uint32_t offset = 0;
+
+    ptr[offset++] = NDN_TLV_NAME;
+    uint32_t name_length_pos = offset;
+    offset++;
+
+    uint32_t name_start = offset;
+    const char *p = name_uri;
+    if (*p == '/') p++; // Skip initial slash
+
+    while (*p) {
+        const char *component_start = p;
+
+        while (*p && *p != '/') p++;
+
+        uint32_t component_len = p - component_start;
+        if (component_len > 0) {
+            ptr[offset++] = NDN_TLV_NAME_COMPONENT;
+            ptr[offset++] = component_len;
+            memcpy(ptr + offset, component_start, component_len);
+            offset += component_len;
+        }
+
+        if (*p == '/') p++;
+    }
+
+    ptr[name_length_pos] = offset - name_start;
+    return offset;
+}
+
+// Create an NDN Interest packet with the given name
+// The nonce is fixed per class so a corpus rebuild reproduces the same
+// bytes and the same steady-state path.
+static uint32_t create_interest(uint8_t *buffer, const char *name_uri,
+                                uint32_t nonce) {
+    uint32_t offset = 0;
+    uint8_t *ptr = buffer;
+
+    ptr[offset++] = NDN_INTEREST;
+    uint32_t interest_length_pos = offset;
+    offset++;
+
+    offset += encode_name(ptr + offset, name_uri);
+
+    ptr[offset++] = NDN_TLV_NONCE;
+    ptr[offset++] = 4;
+    memcpy(ptr + offset, &nonce, sizeof(nonce));
+    offset += sizeof(nonce);
+
+    ptr[offset++] = NDN_TLV_INTEREST_LIFETIME;
+    ptr[offset++] = 2;
+    uint16_t lifetime = htons(4000);
+    memcpy(ptr + offset, &lifetime, sizeof(lifetime));
+    offset += sizeof(lifetime);
+
+    ptr[interest_length_pos] = offset - interest_length_pos - 1;
+    return offset;
+}
+
+// Create an NDN Data packet with the given name and content size
+static uint32_t create_data(uint8_t *buffer, const char *name_uri,
+                            uint32_t content_len) {
+    uint32_t offset = 0;
+    uint8_t *ptr = buffer;
+
+    ptr[offset++] = NDN_DATA;
+    uint32_t data_length_pos = offset;
+    offset++;
+
+    offset += encode_name(ptr + offset, name_uri);
+
+    // MetaInfo { FreshnessPeriod: 10s }
+    ptr[offset++] = NDN_TLV_METAINFO;
+    ptr[offset++] = 4;
+    ptr[offset++] = NDN_TLV_FRESHNESS_PERIOD;
+    ptr[offset++] = 2;
+    uint16_t freshness = htons(10000);
+    memcpy(ptr + offset, &freshness, sizeof(freshness));
+    offset += sizeof(freshness);
+
+    // Content (patterned filler)
+    ptr[offset++] = NDN_TLV_CONTENT;
+    ptr[offset++] = content_len;
+    for (uint32_t i = 0; i < content_len; i++)
+        ptr[offset + i] = (uint8_t)i;
+    offset += content_len;
+
+    // Minimal SignatureInfo (DigestSha256) + empty SignatureValue
+    ptr[offset++] = NDN_TLV_SIGNATURE_INFO;
+    ptr[offset++] = 3;
+    ptr[offset++] = 0x1B; // SignatureType
+    ptr[offset++] = 1;
+    ptr[offset++] = 0;    // DigestSha256
+    ptr[offset++] = NDN_TLV_SIGNATURE_VALUE;
+    ptr[offset++] = 0;
+
+    ptr[data_length_pos] = offset - data_length_pos - 1;
+    return offset;
+}
+
+// Wrap an NDN payload in a raw NDN-ethertype Ethernet frame
+static uint32_t frame_raw_ether(uint8_t *frame, const uint8_t *payload,
+                                uint32_t payload_len) {
+    struct ethhdr *eth = (struct ethhdr *)frame;
+
+    memset(eth, 0, sizeof(*eth));
+    eth->h_dest[5] = 0x02;
+    eth->h_source[5] = 0x01;
+    eth->h_proto = htons(NDN_ETHERTYPE);
+
+    memcpy(frame + sizeof(*eth), payload, payload_len);
+    return sizeof(*eth) + payload_len;
+}
+
+// Wrap an NDN payload in an Ethernet/IPv4/UDP frame to the given port
+static uint32_t frame_udp(uint8_t *frame, const uint8_t *payload,
+                          uint32_t payload_len, uint16_t dest_port) {
+    struct ethhdr *eth = (struct ethhdr *)frame;
+    struct iphdr *ip = (struct iphdr *)(frame + sizeof(*eth));
+    struct udphdr *udp = (struct udphdr *)((uint8_t *)ip + sizeof(*ip));
+    uint8_t *data = (uint8_t *)udp + sizeof(*udp);
+
+    memset(eth, 0, sizeof(*eth));
+    eth->h_dest[5] = 0x02;
+    eth->h_source[5] = 0x01;
+    eth->h_proto = htons(ETH_P_IP);
+
+    memset(ip, 0, sizeof(*ip));
+    ip->version = 4;
+    ip->ihl = 5;
+    ip->ttl = 64;
+    ip->protocol = IPPROTO_UDP;
+    ip->saddr = htonl(0x0A000001); // 10.0.0.1
+    ip->daddr = htonl(0x0A000002); // 10.0.0.2
+    ip->tot_len = htons(sizeof(*ip) + sizeof(*udp) + payload_len);
+    ip->check = ip_checksum(ip, sizeof(*ip));
+
+    udp->source = htons(49152);
+    udp->dest = htons(dest_port);
+    udp->len = htons(sizeof(*udp) + payload_len);
+    udp->check = 0; // Optional over IPv4
+
+    memcpy(data, payload, payload_len);
+    return sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + payload_len;
+}
+
+// ---------------------------------------------------------------------
+// Corpus
+// ---------------------------------------------------------------------
+
+// Build the benchmark corpus: varied name lengths, nesting depths, and
+// cache-hit/miss mixes. One static set so every generation sees the
+// same bytes.
+static int build_corpus(struct bench_case *cases, int max_cases) {
+    uint8_t payload[MAX_FRAME_SIZE];
+    uint32_t len;
+    int n = 0;
+
+    // Shallow name, UDP framing: the baseline Interest cost
+    len = create_interest(payload, "/a/b", 0x11111111);
+    cases[n].label = "Interest, 2 components (UDP)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    n++;
+
+    // Deep name: eight components stresses the TLV walk depth
+    len = create_interest(payload,
+        "/seg0/seg1/seg2/seg3/seg4/seg5/seg6/seg7", 0x22222222);
+    cases[n].label = "Interest, 8 components (UDP)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    n++;
+
+    // Long components: ~130 bytes of encoded name stresses the hash loop
+    len = create_interest(payload,
+        "/cccccccccccccccccccccccccccccccc"
+        "/cccccccccccccccccccccccccccccccc"
+        "/cccccccccccccccccccccccccccccccc"
+        "/cccccccccccccccccccccccccccccccc", 0x33333333);
+    cases[n].label = "Interest, 4x32-byte components (UDP)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    n++;
+
+    // Raw NDN ethertype framing: classification without the IP/UDP walk
+    len = create_interest(payload, "/a/b", 0x44444444);
+    cases[n].label = "Interest, 2 components (raw ether)";
+    cases[n].frame_len = frame_raw_ether(cases[n].frame, payload, len);
+    n++;
+
+    // Cache hit: a Data frame for the same name is run first (untimed),
+    // so the Interest settles onto the content-store serve path
+    len = create_data(payload, "/hit/content", 64);
+    cases[n].label = "Interest, cache hit (UDP)";
+    cases[n].warm_len = frame_udp(cases[n].warm_frame, payload, len,
+                                  NDN_UDP_PORT);
+    len = create_interest(payload, "/hit/content", 0x55555555);
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    // On the pipelined parser a warm cache hit must be served in kernel
+    // (XDP_TX); any other verdict means the pipeline is degrading to the
+    // error/fallback path and none of its numbers measure what they claim
+    cases[n].expect_serve = 1;
+    n++;
+
+    // Data ingest: the store path with a small content payload
+    len = create_data(payload, "/store/small", 64);
+    cases[n].label = "Data, 64-byte content (UDP)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    n++;
+
+    // Larger content payload (200 bytes keeps the enclosing Data TLV
+    // within the 1-byte length form the corpus encoder emits)
+    len = create_data(payload, "/store/large", 200);
+    cases[n].label = "Data, 200-byte content (UDP)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, NDN_UDP_PORT);
+    n++;
+
+    // Non-NDN traffic: classification-only cost (wrong UDP port)
+    len = create_interest(payload, "/a/b", 0x66666666);
+    cases[n].label = "Non-NDN UDP frame (classify only)";
+    cases[n].frame_len = frame_udp(cases[n].frame, payload, len, 9999);
+    n++;
+
+    if (n > max_cases) {
+        fprintf(stderr, "Error: corpus overflow (%d cases)\n", n);
+        return -1;
+    }
+    return n;
+}
+
+// ---------------------------------------------------------------------
+// Program loading and measurement
+// ---------------------------------------------------------------------
+
+// Look up map / program fds by name on the generic object handle
+static int obj_map_fd(struct bpf_object *obj, const char *name) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, name);
+    return map ? bpf_map__fd(map) : -1;
+}
+
+static int obj_prog_fd(struct bpf_object *obj, const char *name) {
+    struct bpf_program *prog = bpf_object__find_program_by_name(obj, name);
+    return prog ? bpf_program__fd(prog) : -1;
+}
+
+// Wire up the v2 tail-call pipeline jump table, as the loader does in
+// setup_pipeline (all features on). Generations without a prog_stages
+// map are single programs and skip this.
+static int setup_stages(struct bpf_object *obj) {
+    int stages_fd = obj_map_fd(obj, "prog_stages");
+    __u32 key;
+    __u32 fd;
+
+    if (stages_fd < 0)
+        return 0; // Not a pipelined parser
+
+    key = STAGE_PARSE;
+    fd = obj_prog_fd(obj, "ndn_stage_parse");
+    if (bpf_map_update_elem(stages_fd, &key, &fd, BPF_ANY) != 0)
+        return -1;
+
+    key = STAGE_CS;
+    fd = obj_prog_fd(obj, "ndn_stage_cs");
+    if (bpf_map_update_elem(stages_fd, &key, &fd, BPF_ANY) != 0)
+        return -1;
+
+    key = STAGE_FORWARD;
+    fd = obj_prog_fd(obj, "ndn_stage_forward");
+    if (bpf_map_update_elem(stages_fd, &key, &fd, BPF_ANY) != 0)
+        return -1;
+
+    return 0;
+}
+
+// Map an XDP verdict to its name for the report
+static const char *verdict_name(int retval) {
+    switch (retval) {
+        case XDP_ABORTED:  return "XDP_ABORTED";
+        case XDP_DROP:     return "XDP_DROP";
+        case XDP_PASS:     return "XDP_PASS";
+        case XDP_TX:       return "XDP_TX";
+        case XDP_REDIRECT: return "XDP_REDIRECT";
+        default:           return "?";
+    }
+}
+
+// Run one frame through a program: a single untimed repetition when
+// timed == 0 (state warm-up), otherwise repeat_count repetitions with
+// the kernel-reported average duration in *duration_ns.
+static int run_frame(int prog_fd, const uint8_t *frame, uint32_t frame_len,
+                     int timed, __u32 *duration_ns, int *retval) {
+    uint8_t data_out[MAX_FRAME_SIZE];
+    LIBBPF_OPTS(bpf_test_run_opts, opts,
+        .data_in = frame,
+        .data_size_in = frame_len,
+        .data_out = data_out,
+        .data_size_out = sizeof(data_out),
+        .repeat = timed ? repeat_count : 1,
+    );
+
+    if (bpf_prog_test_run_opts(prog_fd, &opts) != 0)
+        return -1;
+
+    if (duration_ns)
+        *duration_ns = opts.duration;
+    if (retval)
+        *retval = opts.retval;
+    return 0;
+}
+
+// Benchmark one parser generation over the whole corpus
+static int bench_generation(const struct parser_gen *gen,
+                            struct bench_case *cases, int num_cases) {
+    struct bpf_object *obj;
+    int prog_fd;
+    int mismatches = 0;
+    int i;
+
+    obj = bpf_object__open_file(gen->path, NULL);
+    if (!obj) {
+        fprintf(stderr, "Error: Could not open '%s': %s\n",
+                gen->path, strerror(errno));
+        return -1;
+    }
+
+    if (bpf_object__load(obj) != 0) {
+        fprintf(stderr, "Error: Could not load '%s': %s\n",
+                gen->path, strerror(errno));
+        bpf_object__close(obj);
+        return -1;
+    }
+
+    int pipelined = (obj_map_fd(obj, "prog_stages") >= 0);
+
+    if (setup_stages(obj) != 0) {
+        fprintf(stderr, "Error: Could not wire pipeline for '%s'\n",
+                gen->path);
+        bpf_object__close(obj);
+        return -1;
+    }
+
+    prog_fd = obj_prog_fd(obj, gen->prog_name);
+    if (prog_fd < 0) {
+        fprintf(stderr, "Error: Program '%s' not found in '%s'\n",
+                gen->prog_name, gen->path);
+        bpf_object__close(obj);
+        return -1;
+    }
+
+    printf("\n%s (%s, program %s)\n", gen->label, gen->path, gen->prog_name);
+
+    for (i = 0; i < num_cases; i++) {
+        struct bench_case *c = &cases[i];
+        __u32 duration = 0;
+        int retval = 0;
+
+        // Companion frame (e.g. Data before a cache-hit Interest)
+        if (c->warm_len > 0 &&
+            run_frame(prog_fd, c->warm_frame, c->warm_len, 0,
+                      NULL, NULL) != 0) {
+            fprintf(stderr, "  %-38s: warm-up failed: %s\n",
+                    c->label, strerror(errno));
+            continue;
+        }
+
+        // One untimed repetition of the frame itself, so every class
+        // reports its steady-state path
+        if (run_frame(prog_fd, c->frame, c->frame_len, 0,
+                      NULL, NULL) != 0 ||
+            run_frame(prog_fd, c->frame, c->frame_len, 1,
+                      &duration, &retval) != 0) {
+            fprintf(stderr, "  %-38s: test run failed: %s\n",
+                    c->label, strerror(errno));
+            continue;
+        }
+
+        printf("  %-38s: %6u ns/pkt  [%s]\n",
+               c->label, duration, verdict_name(retval));
+
+        // Guard against a silently dead pipeline: if the serve path
+        // doesn't answer in kernel, every other class is measuring the
+        // error/fallback path and the run must not pass as a baseline
+        if (c->expect_serve && pipelined && retval != XDP_TX) {
+            fprintf(stderr,
+                    "  %-38s: expected XDP_TX, got %s - pipeline broken, "
+                    "results unusable\n",
+                    c->label, verdict_name(retval));
+            mismatches++;
+        }
+    }
+
+    bpf_object__close(obj);
+    return mismatches > 0 ? -1 : 0;
+}
+
+// Print usage information
+void print_usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [OPTIONS]\n"
+        "Options:\n"
+        "  -r REPEAT       Repetitions per corpus class (default: %d)\n"
+        "  -g PATH         First-generation object path\n"
+        "                  (default: %s)\n"
+        "  -h              Display this help and exit\n",
+        prog, DEFAULT_REPEAT, GEN1_OBJ_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+    struct bench_case cases[16];
+    int num_cases;
+    int failures = 0;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "r:g:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                repeat_count = atoi(optarg);
+                if (repeat_count < 1) {
+                    fprintf(stderr, "Error: Invalid repetition count\n");
+                    return 1;
+                }
+                break;
+            case 'g':
+                gen1_obj_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    struct parser_gen gens[] = {
+        { "gen1", gen1_obj_path, "ndn_xdp_func" },
+        { "v1", "ndn_parser.o", "ndn_xdp_parser" },
+        { "v2", "ndn_parser_v2.o", "ndn_xdp_parser_v2" },
+    };
+    int num_gens = sizeof(gens) / sizeof(gens[0]);
+
+    memset(cases, 0, sizeof(cases));
+    num_cases = build_corpus(cases, sizeof(cases) / sizeof(cases[0]));
+    if (num_cases < 0)
+        return 1;
+
+    printf("NDN parser micro-benchmark: %d classes x %d repetitions\n",
+           num_cases, repeat_count);
+
+    for (i = 0; i < num_gens; i++) {
+        if (bench_generation(&gens[i], cases, num_cases) != 0)
+            failures++;
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -53,6 +53,20 @@ struct {
     __uint(max_entries, 1024);          // Maximum number of routes
 } fib SEC(".maps");
 
+// Longest-prefix-match FIB keyed on encoded name-component prefixes
+// NDN forwarding is defined by longest-prefix match; the exact-match hash
+// above only covers full names, so Interests for uncovered exact names
+// fall through to userspace even when a covering prefix route exists.
+// This trie closes that gap: routes are inserted on component boundaries
+// and lookups walk the trie for the most specific covering prefix.
+struct {
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __uint(key_size, sizeof(struct fib_lpm_key));
+    __uint(value_size, sizeof(__u32));  // Interface index
+    __uint(max_entries, 1024);          // Maximum number of prefix routes
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+} fib_lpm SEC(".maps");
+
 // PIT (Pending Interest Table) - Maps name hash to incoming interfaces
 struct pit_entry {
     __u64 expiry;            // Expiration time
@@ -248,6 +262,50 @@ static __always_inline int parse_ndn_name(struct xdp_md *ctx, struct ndn_packet
     return 0;
 }
 
+// Longest-prefix-match FIB lookup on the encoded name
+// Builds an LPM key directly from the raw name-component TLV bytes so
+// trie prefixes align with the component encoding, then returns the
+// egress interface of the most specific covering route (or NULL).
+static __always_inline __u32 *fib_lpm_lookup(struct xdp_md *ctx, struct ndn_packet *pkt) {
+    void *data_end = (void *)(long)ctx->data_end;
+    __u32 offset = sizeof(struct ndn_tlv_hdr);
+    __u64 name_len = 0;
+    struct fib_lpm_key key = {};
+
+    // Locate the Name TLV, same walk as parse_ndn_name
+    struct ndn_tlv_hdr *tlv = (struct ndn_tlv_hdr *)((void *)pkt + offset);
+    if ((void *)tlv + sizeof(*tlv) > data_end)
+        return NULL;
+
+    if (tlv->type != NDN_TLV_NAME)
+        return NULL;
+
+    offset += sizeof(struct ndn_tlv_hdr);
+    if (parse_tlv_length((void *)pkt, data_end, &offset, &name_len) < 0)
+        return NULL;
+
+    __u8 *name_data = (__u8 *)pkt + offset;
+    if ((void *)name_data + name_len > data_end)
+        return NULL;
+
+    // Copy the encoded component TLVs into the key (bounded for verifier)
+    __u32 copy_len = name_len < FIB_LPM_MAX_PREFIX ? name_len : FIB_LPM_MAX_PREFIX;
+
+    #pragma unroll
+    for (int i = 0; i < FIB_LPM_MAX_PREFIX; i++) {
+        if (i >= copy_len)
+            break;
+        if ((void *)(name_data + i + 1) > data_end)
+            break;
+
+        key.data[i] = name_data[i];
+    }
+
+    key.prefixlen = copy_len * 8;
+
+    return bpf_map_lookup_elem(&fib_lpm, &key);
+}
+
 // Increment a metric counter
 static __always_inline void update_metric(int metric_idx) {
     __u64 *counter;
@@ -313,8 +371,11 @@ static __always_inline int process_interest(struct xdp_md *ctx, struct ndn_packe
         bpf_map_update_elem(&pit, &name_hash, &pit_value, BPF_ANY);
     }
     
-    // Check FIB for forwarding
+    // Check FIB for forwarding - exact-match hash first (cheapest), then
+    // fall back to longest-prefix match on the encoded name
     __u32 *fib_entry = bpf_map_lookup_elem(&fib, &name_hash);
+    if (!fib_entry)
+        fib_entry = fib_lpm_lookup(ctx, pkt);
     if (fib_entry && *fib_entry != 0 && *fib_entry != ifindex) {
         // Interest can be forwarded according to FIB
         // In real implementation, we would redirect here
@@ -397,16 +458,18 @@ static __always_inline int extract_content(struct xdp_md *ctx, struct ndn_packet
         entry_buffer.hdr.content_len = content_size;
         entry_buffer.hdr.signature_len = 0; // Not storing signature for now
         
-        // Copy the content data - with bounds checking
-        if (content_ptr + content_size <= data_end) {
-            __u32 i;
-            const __u8 *src = content_ptr;
-            
-            #pragma unroll
-            for (i = 0; i < CS_MAX_CONTENT_SIZE && i < content_size; i++) {
-                entry_buffer.data[i] = src[i];
-            }
-            
+        // Copy the content data - with bounds checking against the
+        // full multi-buffer frame. bpf_xdp_load_bytes walks the
+        // fragments, so jumbo Data whose payload extends past the
+        // linear head is cached too.
+        __u32 content_off = content_ptr - (void *)(long)ctx->data;
+
+        if (content_size > CS_MAX_CONTENT_SIZE)
+            return -1;
+
+        if (content_off + content_size <= bpf_xdp_get_buff_len(ctx) &&
+            bpf_xdp_load_bytes(ctx, content_off, entry_buffer.data,
+                               content_size) == 0) {
             // Update the content store
             bpf_map_update_elem(&content_store, &name_hash, &entry_buffer, BPF_ANY);
             return 0;
@@ -487,7 +550,12 @@ static __always_inline struct xdp_config *get_config() {
     return bpf_map_lookup_elem(&config, &key);
 }
 
-SEC("xdp")
+// Declared xdp.frags (BPF_F_XDP_HAS_FRAGS) so multi-buffer frames on
+// jumbo-MTU links reach the parser at all. Headers and Name TLVs sit in
+// the linear head, so the direct-access walks below are unchanged;
+// content that extends into the fragments is copied with
+// bpf_xdp_load_bytes in extract_content.
+SEC("xdp.frags")
 int ndn_xdp_parser(struct xdp_md *ctx) {
     void *data = (void *)(long)ctx->data;
     void *data_end = (void *)(long)ctx->data_end;
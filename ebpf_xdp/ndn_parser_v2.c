@@ -40,6 +40,13 @@
 #define DECISION_DROP 2       // Drop packet (duplicate, invalid)
 #define DECISION_REDIRECT 3   // Redirect to another interface
 
+// Leading raw Name TLV bytes kept per CS entry so a 64-bit hash
+// collision is detected in-kernel instead of surfacing as a false hit.
+// Sized so the fixed part of cs_entry_v2 stays a multiple of 8 and
+// content[] starts exactly at sizeof(header) - the loader's snapshot
+// and sweep code relies on that.
+#define CS_NAME_PREFIX_LEN 22
+
 // Enhanced content store entry with metadata
 struct cs_entry_v2 {
     __u64 name_hash;          // Name hash (for quick validation)
@@ -48,6 +55,8 @@ struct cs_entry_v2 {
     __u16 content_size;       // Size of the content
     __u8 content_type;        // Content type from NDN packet
     __u8 flags;               // Additional flags
+    __u16 name_len;           // Full Name TLV size (collision check)
+    __u8 name_prefix[CS_NAME_PREFIX_LEN];  // Leading Name TLV bytes
     __u8 content[];           // Flexible array for content data
 };
 
@@ -59,29 +68,177 @@ struct {
     __uint(max_entries, METRIC_MAX);
 } metrics SEC(".maps");
 
-// Enhanced content store with optimized key structure
+// Per-prefix heavy-hitter tracking for the ML control plane
+// A count-min sketch gives an O(1) per-name frequency estimate without
+// per-name state; names whose estimate crosses HH_PROMOTE_THRESHOLD are
+// promoted into the heavy_hitters LRU map, which the loader ranks and
+// exports as the top-N hottest prefixes.
+#define CMS_ROWS 4
+#define CMS_COLS 4096              // Columns per row, power of two
+#define HH_MAX_ENTRIES 1024        // Candidate pool the loader ranks
+#define HH_PROMOTE_THRESHOLD 128   // Sketch estimate that makes a name "hot"
+#define HH_PREFIX_LEN 32           // Leading Name TLV bytes kept per hitter
+
+struct hh_entry {
+    __u64 count;                   // Sketch estimate at last update
+    __u64 last_update;             // bpf_ktime_get_ns() of last update
+    __u16 name_len;                // Full Name TLV size
+    __u8 name_prefix[HH_PREFIX_LEN];  // Leading raw Name TLV bytes
+};
+
+// Count-min sketch counters, CMS_ROWS x CMS_COLS laid out row-major.
+// A plain (shared) array with atomic increments: promotion decisions
+// need the global estimate, which per-CPU slices can't provide.
 struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u64));
+    __uint(max_entries, CMS_ROWS * CMS_COLS);
+} name_cms SEC(".maps");
+
+// Hot-name candidates keyed by name hash; LRU keeps the recently hot
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(key_size, sizeof(__u64));
+    __uint(value_size, sizeof(struct hh_entry));
+    __uint(max_entries, HH_MAX_ENTRIES);
+} heavy_hitters SEC(".maps");
+
+// Bump the sketch for one request and return the new minimum-row
+// estimate. Row columns come from independent 16-bit slices of the
+// 64-bit name hash, so one good hash feeds all four rows.
+static __always_inline __u64 cms_update(__u64 name_hash) {
+    __u64 est = (__u64)-1;
+
+    #pragma unroll
+    for (int row = 0; row < CMS_ROWS; row++) {
+        __u32 idx = row * CMS_COLS +
+                    ((__u32)(name_hash >> (row * 16)) & (CMS_COLS - 1));
+        __u64 *cnt = bpf_map_lookup_elem(&name_cms, &idx);
+
+        if (!cnt)
+            return 0;
+
+        __sync_fetch_and_add(cnt, 1);
+        if (*cnt < est)
+            est = *cnt;
+    }
+
+    return est;
+}
+
+// Enhanced content store with optimized key structure
+// Tagged so it can double as the inner-map template of the wrapper
+// below; CS_MAX_ENTRIES is only the boot-time capacity
+struct cs_store_inner {
     __uint(type, BPF_MAP_TYPE_LRU_HASH);
     __uint(key_size, sizeof(__u64));    // 64-bit name hash
-    __uint(value_size, sizeof(struct cs_entry_v2) + CS_MAX_CONTENT_SIZE); 
+    __uint(value_size, sizeof(struct cs_entry_v2) + CS_MAX_CONTENT_SIZE);
     __uint(max_entries, CS_MAX_ENTRIES);
 } content_store_v2 SEC(".maps");
 
+// Map-in-map wrapper around the content store so capacity can change
+// at runtime: the loader creates a new inner map of the desired size,
+// migrates the live entries, and swaps it into the single slot here -
+// no rebuild, no detach, no dropped packets. Same pattern as the
+// nonce_bloom_gens generations below. The verifier only checks inner
+// key/value compatibility for hash maps, so replacement maps are free
+// to differ in max_entries.
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, 1);
+    __uint(key_size, sizeof(__u32));     // Single active slot
+    __array(values, struct cs_store_inner);
+} content_store_map SEC(".maps") = {
+    .values = { &content_store_v2 },
+};
+
+// Resolve the currently active content store
+static __always_inline void *cs_active(void) {
+    __u32 slot = 0;
+    return bpf_map_lookup_elem(&content_store_map, &slot);
+}
+
+// Chunked content store for objects larger than CS_MAX_CONTENT_SIZE
+// Segmented bulk content (8K-64K Data over jumbo frames) doesn't fit a
+// single cs_entry_v2, so large objects are split into fixed-size chunks:
+// a first-level map holds one descriptor per name hash and a second-level
+// map holds the individual chunks keyed by {name hash, chunk index}.
+#define CS_CHUNK_SIZE CS_MAX_CONTENT_SIZE  // Payload bytes per chunk
+#define CS_MAX_CHUNKS 16                   // Up to 64KB per object
+#define CS_CHUNK_OBJECTS 4096              // Max chunked objects
+
+// Descriptor for one chunked object
+struct cs_chunk_desc {
+    __u64 name_hash;          // Name hash (for quick validation)
+    __u64 insertion_time;     // When the content was inserted
+    __u32 expiry_time;        // Time to live in seconds
+    __u32 total_size;         // Total object size across all chunks
+    __u16 chunk_count;        // Number of chunks stored
+    __u8 content_type;        // Content type from NDN packet
+    __u8 flags;               // Additional flags
+};
+
+// Key for one chunk of a chunked object
+struct cs_chunk_key {
+    __u64 name_hash;          // Name hash of the owning object
+    __u32 chunk_idx;          // Chunk index within the object
+    __u32 reserved;           // Pad to 16 bytes for alignment
+};
+
+// One stored chunk
+struct cs_chunk {
+    __u16 chunk_size;         // Valid bytes in data[]
+    __u16 reserved;
+    __u8 content[];           // Flexible array for chunk data
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(key_size, sizeof(__u64));    // 64-bit name hash
+    __uint(value_size, sizeof(struct cs_chunk_desc));
+    __uint(max_entries, CS_CHUNK_OBJECTS);
+} cs_chunk_index SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(key_size, sizeof(struct cs_chunk_key));
+    __uint(value_size, sizeof(struct cs_chunk) + CS_CHUNK_SIZE);
+    __uint(max_entries, CS_CHUNK_OBJECTS * CS_MAX_CHUNKS);
+} cs_chunk_store SEC(".maps");
+
 // Enhanced PIT with better expiry handling
+// Maximum number of downstream faces aggregated on one PIT entry
+#define PIT_MAX_FACES 4
+
+// One pending downstream face on a PIT entry
+struct pit_face {
+    __u32 ifindex;            // Interface the Interest arrived on
+    __u32 nonce;              // Nonce seen from that face
+};
+
 struct pit_entry_v2 {
     __u64 name_hash;          // Name hash for verification
     __u64 arrival_time;       // When the interest arrived
     __u32 lifetime_ms;        // Interest lifetime in milliseconds
-    __u32 ingress_ifindex;    // Interface where Interest arrived
+    __u32 ingress_ifindex;    // First face (single-face fast path)
     __u32 nonce;              // Nonce for loop detection
     __u8 hop_count;           // Number of hops this interest has traversed
+    __u8 face_count;          // Valid entries in faces[]
+    struct pit_face faces[PIT_MAX_FACES];  // Aggregated pending faces
+    struct bpf_timer timer;   // Fires at arrival_time + lifetime_ms
 };
 
+// Plain HASH, not LRU: each entry's timer removes it at exactly its
+// deadline, so capacity reflects real concurrency. With LRU eviction,
+// expired Interests lingered until capacity pressure pushed them out,
+// and under pressure still-pending entries were evicted early and the
+// late Data was dropped as unsolicited.
 struct {
-    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(type, BPF_MAP_TYPE_HASH);
     __uint(key_size, sizeof(__u64));     // 64-bit name hash
     __uint(value_size, sizeof(struct pit_entry_v2));
-    __uint(max_entries, 4096);           // Increased capacity
+    __uint(max_entries, 4096);
 } pit_v2 SEC(".maps");
 
 // Duplicate detection cache for quick Interest deduplication
@@ -92,6 +249,184 @@ struct {
     __uint(max_entries, 8192);           // Large enough to catch most duplicates
 } nonce_cache SEC(".maps");
 
+// Bloom filter front-end for nonce deduplication
+// Answering "seen recently?" doesn't need a full hash map with buckets
+// and LRU lists for every nonce - the bloom filters absorb the common
+// "definitely new" case in a fraction of the memory, and the LRU above
+// is only consulted as the confirm stage when a filter reports a hit.
+//
+// Two generations are kept in an array-of-maps so userspace can rotate
+// in a fresh empty filter periodically (bloom filters can't be cleared
+// in place), which keeps the false-positive rate bounded.
+struct nonce_bloom_inner {
+    __uint(type, BPF_MAP_TYPE_BLOOM_FILTER);
+    __uint(max_entries, NONCE_BLOOM_ENTRIES);
+    __uint(value_size, sizeof(__u32));   // Nonce
+    __uint(map_extra, NONCE_BLOOM_HASHES);
+} nonce_bloom_gen0 SEC(".maps"), nonce_bloom_gen1 SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, 2);
+    __uint(key_size, sizeof(__u32));     // Generation slot (0 or 1)
+    __array(values, struct nonce_bloom_inner);
+} nonce_bloom_gens SEC(".maps") = {
+    .values = { &nonce_bloom_gen0, &nonce_bloom_gen1 },
+};
+
+// Index of the currently active generation, flipped by the loader on
+// each rotation
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u32));
+} nonce_bloom_gen SEC(".maps");
+
+// Check a nonce against both bloom generations and record it in the
+// current one. Returns 1 if the nonce may have been seen recently
+// (confirm against nonce_cache before acting on it), 0 if it is
+// definitely new.
+static __always_inline int nonce_bloom_maybe_seen(__u32 nonce) {
+    __u32 key = 0;
+    int maybe = 0;
+
+    __u32 *gen = bpf_map_lookup_elem(&nonce_bloom_gen, &key);
+    __u32 curr = gen ? (*gen & 1) : 0;
+    __u32 prev = curr ^ 1;
+
+    void *bloom = bpf_map_lookup_elem(&nonce_bloom_gens, &curr);
+    if (bloom && bpf_map_peek_elem(bloom, &nonce) == 0)
+        maybe = 1;
+
+    if (!maybe) {
+        void *prev_bloom = bpf_map_lookup_elem(&nonce_bloom_gens, &prev);
+        if (prev_bloom && bpf_map_peek_elem(prev_bloom, &nonce) == 0)
+            maybe = 1;
+    }
+
+    // Record in the current generation either way
+    if (bloom)
+        bpf_map_push_elem(bloom, &nonce, BPF_ANY);
+
+    return maybe;
+}
+
+// TinyLFU-style admission filter (doorkeeper) for the content store
+// Caching every arriving Data means one sequential bulk transfer of
+// unique names churns the whole 32K-entry LRU and evicts the hot
+// working set. The doorkeeper is a compact per-name-hash count sketch
+// bumped once per Data arrival; data_cs_stage only admits content once
+// its count reaches cs_admission_threshold, so a one-hit wonder never
+// displaces a resident entry (with the default threshold of 2, content
+// is cached on its second request).
+//
+// Two generations in an array-of-maps, same pattern as
+// nonce_bloom_gens above: the loader swaps a fresh zeroed sketch into
+// the stale slot every cs_admission_window seconds and flips the index,
+// so counts age out and admission always reflects recent popularity.
+#define DOORKEEPER_ROWS 2
+#define DOORKEEPER_COLS 8192      // Columns per row, power of two
+
+struct doorkeeper_inner {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u32));
+    __uint(max_entries, DOORKEEPER_ROWS * DOORKEEPER_COLS);
+} cs_doorkeeper_gen0 SEC(".maps"), cs_doorkeeper_gen1 SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, 2);
+    __uint(key_size, sizeof(__u32));     // Generation slot (0 or 1)
+    __array(values, struct doorkeeper_inner);
+} cs_doorkeeper_gens SEC(".maps") = {
+    .values = { &cs_doorkeeper_gen0, &cs_doorkeeper_gen1 },
+};
+
+// Index of the currently active generation, flipped by the loader on
+// each rotation
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u32));
+} cs_doorkeeper_gen SEC(".maps");
+
+// Take the minimum-row estimate for a name from one doorkeeper
+// generation, bumping the counters when inc is set. Row columns come
+// from independent 32-bit slices of the name hash, as in cms_update.
+static __always_inline __u64 doorkeeper_estimate(void *sketch, __u64 name_hash,
+                                             int inc) {
+    __u64 est = (__u64)-1;
+
+    #pragma unroll
+    for (int row = 0; row < DOORKEEPER_ROWS; row++) {
+        __u32 idx = row * DOORKEEPER_COLS +
+                    ((__u32)(name_hash >> (row * 32)) & (DOORKEEPER_COLS - 1));
+        __u32 *cnt = bpf_map_lookup_elem(sketch, &idx);
+
+        if (!cnt)
+            return 0;
+
+        if (inc)
+            __sync_fetch_and_add(cnt, 1);
+        if (*cnt < est)
+            est = *cnt;
+    }
+
+    return est;
+}
+
+// Record one request for a name in the doorkeeper and return its
+// request-count estimate for the window. The previous generation is
+// read without incrementing and added in, so a rotation mid-window
+// doesn't knock every in-flight name back to zero.
+static __always_inline __u64 doorkeeper_update(__u64 name_hash) {
+    __u32 key = 0;
+    __u64 est = 0;
+
+    __u32 *gen = bpf_map_lookup_elem(&cs_doorkeeper_gen, &key);
+    __u32 curr = gen ? (*gen & 1) : 0;
+    __u32 prev = curr ^ 1;
+
+    void *sketch = bpf_map_lookup_elem(&cs_doorkeeper_gens, &curr);
+    if (sketch)
+        est = doorkeeper_estimate(sketch, name_hash, 1);
+
+    void *prev_sketch = bpf_map_lookup_elem(&cs_doorkeeper_gens, &prev);
+    if (prev_sketch)
+        est += doorkeeper_estimate(prev_sketch, name_hash, 0);
+
+    return est;
+}
+
+// In-kernel Interest rate limiting
+// Token buckets keyed by the top RATE_PREFIX_BITS of the name hash, so
+// one bucket covers a slice of the name space rather than a single
+// name - a flood of unique names under the same prefix drains one
+// bucket instead of creating millions. The loader installs per-prefix
+// policies; the entry at RATE_LIMIT_DEFAULT_KEY (outside the prefix key
+// space) is a template applied to any prefix without an explicit policy.
+#define RATE_PREFIX_BITS 16
+#define RATE_LIMIT_DEFAULT_KEY 0x10000
+#define RATE_LIMIT_MAX_ENTRIES ((1 << RATE_PREFIX_BITS) + 1)
+
+struct token_bucket {
+    __s64 tokens;        // Remaining Interests; may dip slightly below
+                         // zero under cross-CPU races, refill recovers
+    __u64 last_refill;   // ns timestamp of the last refill
+    __u32 rate_pps;      // Sustained Interests per second (0 = unlimited)
+    __u32 burst;         // Bucket depth in Interests
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(key_size, sizeof(__u32));     // name_hash >> (64 - RATE_PREFIX_BITS)
+    __uint(value_size, sizeof(struct token_bucket));
+    __uint(max_entries, RATE_LIMIT_MAX_ENTRIES);
+} rate_limits SEC(".maps");
+
 // Configuration map for XDP program behavior
 struct xdp_config_v2 {
     __u8 hash_algorithm;        // Which hash algorithm to use
@@ -103,7 +438,9 @@ struct xdp_config_v2 {
     __u8 zero_copy_enabled;     // Whether to use zero-copy packet handling
     __u8 nested_tlv_optimization; // Whether to use optimized TLV parsing
     __u8 userspace_fallback_threshold; // When to fall back to userspace (0-100%)
-    __u8 reserved[3];           // Reserved for future use
+    __u8 event_sample_log2;     // Emit 1-in-2^k events (0 = every event)
+    __u8 cs_admission_threshold; // Requests before Data is cached (0/1 = cache all)
+    __u8 cs_admission_window;   // Doorkeeper rotation period in seconds
 };
 
 struct {
@@ -119,6 +456,52 @@ struct {
     __uint(max_entries, 256 * 1024); // 256KB ring buffer
 } events SEC(".maps");
 
+// AF_XDP socket map for zero-copy userspace fallback
+// One slot per RX queue; the loader registers an AF_XDP socket fd for
+// each queue it manages so fallback traffic lands in userspace rings
+// instead of crawling through the full kernel network stack.
+struct {
+    __uint(type, BPF_MAP_TYPE_XSKMAP);
+    __uint(key_size, sizeof(__u32));    // RX queue index
+    __uint(value_size, sizeof(__u32));  // AF_XDP socket fd
+    __uint(max_entries, 64);
+} xsks_map SEC(".maps");
+
+// Name-hash CPU steering
+// RSS hashes the UDP 5-tuple, so Interests for the same name arriving
+// from different consumers land on different cores and contend on the
+// same content_store_v2 and pit_v2 buckets. When the loader configures
+// a core set here, the parse stage redirects each packet to the core
+// that owns its slice of the name space (name hash modulo set size) and
+// ndn_cpumap_rx finishes processing there - each core then sees an
+// effectively private slice of the name space. An empty set (count 0)
+// leaves steering off at the cost of one array lookup per packet.
+#define CPU_STEER_MAX 64
+
+struct {
+    __uint(type, BPF_MAP_TYPE_CPUMAP);
+    __uint(key_size, sizeof(__u32));    // CPU id
+    __uint(value_size, sizeof(struct bpf_cpumap_val));
+    __uint(max_entries, CPU_STEER_MAX);
+} cpu_steer SEC(".maps");
+
+// Dense slot -> CPU id mapping for the modulo, installed by the loader
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(key_size, sizeof(__u32));    // Slot (0..count-1)
+    __uint(value_size, sizeof(__u32));  // CPU id
+    __uint(max_entries, CPU_STEER_MAX);
+} cpu_steer_set SEC(".maps");
+
+// Number of active slots, published last so the data path never acts
+// on a partially configured set (0 = steering disabled)
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u32));
+    __uint(max_entries, 1);
+} cpu_steer_count SEC(".maps");
+
 // Event structure for reporting to userspace
 struct event {
     __u64 timestamp;
@@ -236,48 +619,95 @@ static __always_inline int fast_parse_tlv_type(void *data, void *data_end, __u32
     }
 }
 
+// Longest name the hash covers, in bytes. URI-style hierarchical names
+// easily exceed 64 bytes, so the hash must not stop early.
+#define MAX_NAME_LEN 256
+
+// Context threaded through the bpf_loop body below. The packet is
+// re-derived from ctx on every iteration instead of carrying raw
+// packet pointers across the callback boundary, which keeps the
+// verifier's range tracking intact.
+struct xxhash_loop_ctx {
+    struct xdp_md *ctx;
+    __u32 base;          // Packet offset of the first 8-byte block
+    __u32 block_count;   // Number of blocks to process
+    __u64 h64;           // Running hash state
+};
+
+// One 8-byte block round of xxhash, as a bpf_loop body. Returns 1 to
+// stop the loop when a block would cross data_end.
+static int xxhash_block_body(__u32 index, void *arg) {
+    const __u64 PRIME64_1 = 11400714785074694791ULL;
+    const __u64 PRIME64_2 = 14029467366897019727ULL;
+    const __u64 PRIME64_4 = 9650029242287828579ULL;
+    struct xxhash_loop_ctx *c = arg;
+    void *data = (void *)(long)c->ctx->data;
+    void *data_end = (void *)(long)c->ctx->data_end;
+
+    if (index >= c->block_count)
+        return 1;
+
+    __u8 *p = (__u8 *)data + c->base + index * 8;
+    if (p + 8 > (__u8 *)data_end)
+        return 1;
+
+    __u64 k1 = *(__u64 *)p;
+    c->h64 ^= k1 * PRIME64_2;
+    c->h64 = ((c->h64 << 31) | (c->h64 >> 33)) * PRIME64_1;
+    c->h64 = c->h64 * PRIME64_1 + PRIME64_4;
+
+    return 0;
+}
+
 // Enhanced hash function optimized for kernel execution
-static __always_inline __u64 xxhash(__u8 *data, __u32 length, __u64 seed, void *data_end) {
+// Long inputs used to stop after eight 8-byte blocks (the old unroll
+// cap), so any two names sharing their first 64 bytes collided. The
+// block loop now runs under bpf_loop and covers names up to
+// MAX_NAME_LEN, tail bytes included.
+static __always_inline __u64 xxhash(struct xdp_md *ctx, __u8 *data, __u32 length,
+                                    __u64 seed, void *data_end) {
     const __u64 PRIME64_1 = 11400714785074694791ULL;
     const __u64 PRIME64_2 = 14029467366897019727ULL;
     const __u64 PRIME64_3 = 1609587929392839161ULL;
-    const __u64 PRIME64_4 = 9650029242287828579ULL;
     const __u64 PRIME64_5 = 2870177450012600261ULL;
-    
+
     __u64 h64;
-    
+
     // Safety check
     if (data + length > data_end)
         length = data_end - data;
-    
+    if (length > MAX_NAME_LEN)
+        length = MAX_NAME_LEN;
+
     // Special handling based on length
     if (length >= 32) {
-        // For longer inputs, we'd need the full algorithm
-        // But BPF verifier limits make this difficult
-        // Use a simplified approach for eBPF compatibility
-        h64 = seed + PRIME64_5;
-        
-        // Process in 8-byte blocks as much as possible
-        __u32 block_count = length / 8;
-        
-        // BPF loops can't have dynamic iteration counts, 
-        // so we'll limit to a reasonable max
+        struct xxhash_loop_ctx loop_ctx = {
+            .ctx = ctx,
+            .base = (__u32)((long)data - (long)(void *)(long)ctx->data),
+            .block_count = length / 8,
+            .h64 = seed + PRIME64_5,
+        };
+
+        // Process every full 8-byte block - bpf_loop takes the dynamic
+        // iteration count the unrolled loop couldn't
+        bpf_loop(MAX_NAME_LEN / 8, xxhash_block_body, &loop_ctx, 0);
+        h64 = loop_ctx.h64;
+
+        // Process the remaining tail bytes
+        __u32 tail = (length / 8) * 8;
         #pragma unroll
-        for (int i = 0; i < 8; i++) {
-            if (i >= block_count) break;
-            
+        for (int i = 0; i < 7; i++) {
+            if (tail + i >= length) break;
+
             // Safety check for each access
-            if (data + (i * 8) + 8 > data_end) break;
-            
-            __u64 k1 = *(__u64 *)(data + (i * 8));
-            h64 ^= k1 * PRIME64_2;
-            h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
-            h64 = h64 * PRIME64_1 + PRIME64_4;
+            if (data + tail + i + 1 > data_end) break;
+
+            h64 ^= (__u64)data[tail + i] * PRIME64_5;
+            h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
         }
-        
-        // Process remaining bytes
+
         h64 += length;
-    } 
+    }
     else if (length >= 16) {
         h64 = seed + PRIME64_5;
         
@@ -352,29 +782,99 @@ static __always_inline void update_metric(int metric_idx) {
         __sync_fetch_and_add(counter, 1);
 }
 
+// Per-CPU log2 histogram of processing_time_ns
+// Bucket b counts samples in [2^b, 2^(b+1)) ns; the loader sums the
+// per-CPU slots and derives real latency percentiles from it.
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, LATENCY_BUCKETS);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u64));
+} latency_hist SEC(".maps");
+
+// Record a processing time in the log2 histogram
+static __always_inline void record_latency(__u64 ns) {
+    __u32 bucket = 0;
+
+    #pragma unroll
+    for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        if (ns > 1) {
+            ns >>= 1;
+            bucket++;
+        }
+    }
+
+    __u64 *counter = bpf_map_lookup_elem(&latency_hist, &bucket);
+    if (counter)
+        (*counter)++;
+}
+
 // Send an event to userspace via ring buffer
-static __always_inline void send_event(__u32 event_type, __u64 name_hash, 
+static __always_inline void send_event(__u32 event_type, __u64 name_hash,
                                       __u32 packet_size, __u32 action,
                                       __u64 start_time) {
     struct event *e;
-    
+    __u64 now = get_timestamp_ns();
+    __u64 elapsed = now - start_time;
+
+    // The histogram is recorded even when the ring buffer is full, so
+    // latency percentiles aren't skewed by consumer backpressure
+    record_latency(elapsed);
+
+    // 1-in-2^k sampling keyed on the name hash: a given name is either
+    // always reported or never, so per-name event sequences stay intact
+    // and counts scale back by exactly 2^k. At line rate this is what
+    // keeps reservation failures (silent event loss) from happening in
+    // the first place.
+    __u32 cfg_key = 0;
+    struct xdp_config_v2 *cfg = bpf_map_lookup_elem(&config_v2, &cfg_key);
+    if (cfg && cfg->event_sample_log2 &&
+        (name_hash & ((1ULL << (cfg->event_sample_log2 & 31)) - 1)))
+        return;
+
     // Reserve space in the ring buffer
     e = bpf_ringbuf_reserve(&events, sizeof(struct event), 0);
     if (!e)
         return;
-    
+
     // Fill the event data
-    e->timestamp = get_timestamp_ns();
+    e->timestamp = now;
     e->event_type = event_type;
     e->name_hash = name_hash;
     e->packet_size = packet_size;
     e->action_taken = action;
-    e->processing_time_ns = get_timestamp_ns() - start_time;
-    
+    e->processing_time_ns = elapsed;
+
     // Submit the event
     bpf_ringbuf_submit(e, 0);
 }
 
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC 1
+#endif
+
+// Timer callback for a PIT entry that was never satisfied: report the
+// timeout through the ring buffer and free the slot immediately.
+// Emitted directly rather than via send_event so timeouts neither go
+// through event sampling nor pollute the packet latency histogram.
+static int pit_expire_cb(void *map, __u64 *key, struct pit_entry_v2 *entry) {
+    struct event *e = bpf_ringbuf_reserve(&events, sizeof(struct event), 0);
+
+    if (e) {
+        e->timestamp = get_timestamp_ns();
+        e->event_type = EVENT_INTEREST_TIMEOUT;
+        e->name_hash = entry->name_hash;
+        e->packet_size = 0;
+        e->action_taken = DECISION_DROP;
+        e->processing_time_ns = 0;
+        bpf_ringbuf_submit(e, 0);
+    }
+
+    // Deleting the element also releases this timer
+    bpf_map_delete_elem(map, key);
+    return 0;
+}
+
 // Fast name hash calculation optimized for BPF
 static __always_inline int fast_hash_ndn_name(struct xdp_md *ctx, void *data, __u32 offset, 
                                           __u64 *name_hash, __u32 *name_size) {
@@ -406,17 +906,195 @@ static __always_inline int fast_hash_ndn_name(struct xdp_md *ctx, void *data, __
         return -1;
     
     // Compute the hash of the name
-    *name_hash = xxhash(name_start, name_length, 0, data_end);
+    *name_hash = xxhash(ctx, name_start, name_length, 0, data_end);
     
     return 0;
 }
 
+// Tail-call pipeline
+// The parser is split into specialized stages (classify, parse, CS,
+// forward) chained through this jump table so each stage gets its own
+// verifier budget and stages can be swapped independently at runtime.
+// The loader wires the table up after load; a disabled feature's slot
+// can point straight at the next stage instead of branching per packet.
+struct {
+    __uint(type, BPF_MAP_TYPE_PROG_ARRAY);
+    __uint(max_entries, STAGE_MAX);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u32));
+} prog_stages SEC(".maps");
+
+// Per-packet state handed between pipeline stages. Tail calls don't
+// share the stack, so the classify/parse results ride in a per-CPU
+// scratch slot (XDP programs don't migrate CPUs mid-packet).
+struct pipeline_state {
+    __u64 name_hash;     // Filled by the parse stage
+    __u64 start_time;    // Set at classification
+    __u32 pkt_offset;    // Offset of the Name TLV
+    __u32 name_size;     // Filled by the parse stage
+    __u32 pkt_type;      // NDN_INTEREST or NDN_DATA
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(struct pipeline_state));
+} pipeline_state_map SEC(".maps");
+
+static __always_inline struct pipeline_state *get_pipeline_state(void) {
+    __u32 key = 0;
+    return bpf_map_lookup_elem(&pipeline_state_map, &key);
+}
+
+// Promote a hot name into the heavy_hitters candidate map, capturing
+// the leading Name TLV bytes so the export carries a readable prefix,
+// not just a hash
+static __always_inline void hh_promote(struct xdp_md *ctx,
+                                       struct pipeline_state *st,
+                                       __u64 estimate) {
+    void *data = (void *)(long)ctx->data;
+    void *data_end = (void *)(long)ctx->data_end;
+    __u8 *name = (__u8 *)data + st->pkt_offset;
+    struct hh_entry entry = {
+        .count = estimate,
+        .last_update = get_timestamp_ns(),
+        .name_len = st->name_size,
+    };
+
+    #pragma unroll
+    for (int i = 0; i < HH_PREFIX_LEN; i++) {
+        if ((__u32)i >= st->name_size)
+            break;
+
+        // Safety check for each access
+        if (name + i + 1 > (__u8 *)data_end)
+            break;
+
+        entry.name_prefix[i] = name[i];
+    }
+
+    bpf_map_update_elem(&heavy_hitters, &st->name_hash, &entry, BPF_ANY);
+}
+
+// Verify a CS hit really is the same name: the 64-bit hash alone can
+// collide, so the stored name length and leading Name TLV bytes must
+// also match the packet's before the entry counts as a hit
+static __always_inline int cs_name_matches(struct xdp_md *ctx,
+                                           struct cs_entry_v2 *entry,
+                                           __u32 name_offset, __u32 name_size) {
+    void *data = (void *)(long)ctx->data;
+    void *data_end = (void *)(long)ctx->data_end;
+    __u8 *name = (__u8 *)data + name_offset;
+
+    if (entry->name_len != name_size)
+        return 0;
+
+    #pragma unroll
+    for (int i = 0; i < CS_NAME_PREFIX_LEN; i++) {
+        if ((__u32)i >= name_size)
+            break;
+
+        // Safety check for each access
+        if (name + i + 1 > (__u8 *)data_end)
+            return 0;
+
+        if (name[i] != entry->name_prefix[i])
+            return 0;
+    }
+
+    return 1;
+}
+
 // Optimized function to check if content is expired
 static __always_inline int content_expired(struct cs_entry_v2 *entry) {
     __u32 now = get_timestamp_sec();
     return (now >= (entry->insertion_time + entry->expiry_time));
 }
 
+// Check if a chunked object descriptor has expired
+static __always_inline int chunk_desc_expired(struct cs_chunk_desc *desc) {
+    __u32 now = get_timestamp_sec();
+    return (now >= (desc->insertion_time + desc->expiry_time));
+}
+
+// Verify all chunks of an object are still resident
+// The chunk store is an LRU map, so individual chunks can be evicted
+// under memory pressure; an object only counts as a hit if every chunk
+// is still present.
+static __always_inline int chunked_object_complete(__u64 name_hash, __u16 chunk_count) {
+    struct cs_chunk_key key = {
+        .name_hash = name_hash,
+        .chunk_idx = 0,
+        .reserved = 0
+    };
+
+    #pragma unroll
+    for (int i = 0; i < CS_MAX_CHUNKS; i++) {
+        if (i >= chunk_count)
+            break;
+
+        key.chunk_idx = i;
+        if (!bpf_map_lookup_elem(&cs_chunk_store, &key))
+            return 0;
+    }
+
+    return 1;
+}
+
+// Consult the token bucket for this Interest's name-hash prefix.
+// Returns 1 if the Interest may proceed, 0 if it should be shed.
+//
+// Refill advances last_refill only by the time the added tokens account
+// for, so sub-token fractions of the interval carry over instead of
+// being rounded away on every packet. Bucket state is shared across
+// CPUs without locking; the occasional lost update just makes the limit
+// approximate, which is fine for flood shedding.
+static __always_inline int interest_rate_allowed(__u64 name_hash) {
+    __u32 key = (__u32)(name_hash >> (64 - RATE_PREFIX_BITS));
+
+    struct token_bucket *tb = bpf_map_lookup_elem(&rate_limits, &key);
+    if (!tb) {
+        // No explicit policy - instantiate a bucket from the default
+        // template, if the loader configured one
+        __u32 def_key = RATE_LIMIT_DEFAULT_KEY;
+        struct token_bucket *def = bpf_map_lookup_elem(&rate_limits, &def_key);
+        if (!def || def->rate_pps == 0)
+            return 1;
+
+        struct token_bucket fresh = {
+            .tokens = def->burst,
+            .last_refill = get_timestamp_ns(),
+            .rate_pps = def->rate_pps,
+            .burst = def->burst,
+        };
+        bpf_map_update_elem(&rate_limits, &key, &fresh, BPF_NOEXIST);
+
+        tb = bpf_map_lookup_elem(&rate_limits, &key);
+        if (!tb)
+            return 1;
+    }
+
+    if (tb->rate_pps == 0)
+        return 1;  // Explicitly unlimited prefix
+
+    __u64 now = get_timestamp_ns();
+    if (now > tb->last_refill) {
+        __u64 add = (now - tb->last_refill) * tb->rate_pps / 1000000000ULL;
+        if (add > 0) {
+            __s64 t = tb->tokens + add;
+            tb->tokens = (t > (__s64)tb->burst) ? (__s64)tb->burst : t;
+            tb->last_refill += add * 1000000000ULL / tb->rate_pps;
+        }
+    }
+
+    if (tb->tokens <= 0)
+        return 0;
+
+    tb->tokens--;
+    return 1;
+}
+
 // Initialize configuration with defaults
 static __always_inline void init_config_v2() {
     struct xdp_config_v2 cfg = {
@@ -428,7 +1106,9 @@ static __always_inline void init_config_v2() {
         .cs_max_size = CS_MAX_CONTENT_SIZE,
         .zero_copy_enabled = 1,
         .nested_tlv_optimization = 1,
-        .userspace_fallback_threshold = 20  // 20% fallback rate
+        .userspace_fallback_threshold = 20, // 20% fallback rate
+        .cs_admission_threshold = 2,        // Admit on the second request
+        .cs_admission_window = 60           // Doorkeeper rotation period
     };
     
     __u32 key = 0;
@@ -440,3 +1120,12 @@ static __always_inline struct xdp_config_v2 *get_config_v2() {
     __u32 key = 0;
     return bpf_map_lookup_elem(&config_v2, &key);
 }
+
+// Hand a packet to userspace through the AF_XDP fast path
+// If an AF_XDP socket is registered for this packet's RX queue, redirect
+// the frame zero-copy into its RX ring; the XDP_PASS flag makes the
+// kernel fall back to the normal stack when no socket is bound (e.g. the
+// loader is running without AF_XDP mode), so behavior degrades gracefully.
+static __always_inline int fallback_to_userspace(struct xdp_md *ctx) {
+    return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+}
@@ -3,214 +3,1058 @@
 // Part 2: Packet processing logic
 //
 
-// Process Interest packet with enhanced caching and zero-copy
-static __always_inline int process_interest_v2(struct xdp_md *ctx, void *data, 
-                                           __u32 pkt_offset, struct xdp_config_v2 *cfg) {
+// Maximum Interest name we can echo back in an in-kernel Data reply;
+// longer names fall back to the userspace serve path
+#define REPLY_NAME_MAX 64
+
+// Recompute the IPv4 header checksum (20-byte header, no options)
+static __always_inline __u16 ip_fast_csum(struct iphdr *ip) {
+    __u32 sum = 0;
+    __u16 *p = (__u16 *)ip;
+
+    #pragma unroll
+    for (int i = 0; i < 10; i++)
+        sum += p[i];
+
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    return (__u16)~sum;
+}
+
+// Build a Data reply in place from a content store entry and bounce it
+// back out the ingress interface. Swaps the Ethernet (and IP/UDP, when
+// present) header directions, resizes the frame with bpf_xdp_adjust_tail
+// to fit the cached content, and emits a minimal well-formed Data TLV:
+// the Name echoed from the Interest plus a Content block.
+//
+// Returns XDP_TX on success. Returns -1 if the frame was left untouched
+// and the caller should fall back to the userspace serve path (name too
+// long, IP options, exotic framing). Returns XDP_DROP if the frame was
+// already resized when a later step failed - at that point it is no
+// longer a valid Interest and must not be passed on.
+static __always_inline int serve_data_from_cache(struct xdp_md *ctx,
+                                             struct cs_entry_v2 *entry,
+                                             __u32 pkt_offset, __u32 name_size) {
+    void *data = (void *)(long)ctx->data;
     void *data_end = (void *)(long)ctx->data_end;
-    __u64 name_hash;
-    __u32 name_size;
-    __u64 start_time = get_timestamp_ns();
-    __u8 action = DECISION_PASS;  // Default action
-    
-    // Get Interest Name and compute hash
-    if (fast_hash_ndn_name(ctx, data, pkt_offset, &name_hash, &name_size) < 0) {
-        update_metric(METRIC_ERRORS);
-        return XDP_PASS;  // Let userspace handle malformed packets
+
+    if (name_size < 2 || name_size > REPLY_NAME_MAX)
+        return -1;
+
+    __u32 content_size = entry->content_size;
+    if (content_size > CS_MAX_CONTENT_SIZE)
+        return -1;
+
+    // Detect UDP/IP vs direct Ethernet framing before touching anything.
+    // The reply's outer TLV is rebuilt at the start of the NDN payload,
+    // directly after the link (and IP/UDP) headers - the Interest's own
+    // outer header is overwritten along with everything after it.
+    struct ethhdr *eth = data;
+    if ((void *)(eth + 1) > data_end)
+        return -1;
+    int is_udp = (bpf_ntohs(eth->h_proto) == ETH_P_IP);
+    __u32 ndn_off = sizeof(struct ethhdr);
+
+    if (is_udp) {
+        struct iphdr *ip = (struct iphdr *)(eth + 1);
+        if ((void *)(ip + 1) > data_end)
+            return -1;
+        // Only rewrite option-less IPv4 headers in kernel
+        if (ip->ihl != 5)
+            return -1;
+        struct udphdr *udp = (struct udphdr *)(ip + 1);
+        if ((void *)(udp + 1) > data_end)
+            return -1;
+        ndn_off += sizeof(struct iphdr) + sizeof(struct udphdr);
     }
-    
-    update_metric(METRIC_INTERESTS_RECV);
-    
-    // Check if we have this content in our store
-    if (cfg->cs_enabled) {
-        struct cs_entry_v2 *entry = bpf_map_lookup_elem(&content_store_v2, &name_hash);
-        
-        if (entry && !content_expired(entry)) {
-            // We have valid content in our store
-            update_metric(METRIC_CACHE_HITS);
-            
-            // Create Data packet from the cache, but only if it's small enough
-            if (entry->content_size <= cfg->cs_max_size) {
-                // For now, we'll let userspace send the Data
-                // In a more advanced implementation, we could craft and TX the response directly
-                
+
+    // Capture the Interest Name on the stack (pkt_offset points at the
+    // Name TLV type, so these name_size bytes are the complete Name
+    // TLV) - bpf_xdp_adjust_tail invalidates all packet pointers
+    __u8 name_buf[REPLY_NAME_MAX];
+    __u8 *name_ptr = data + pkt_offset;
+    #pragma unroll
+    for (int i = 0; i < REPLY_NAME_MAX; i++) {
+        if (i >= name_size)
+            break;
+        if ((void *)(name_ptr + i + 1) > data_end)
+            return -1;
+        name_buf[i] = name_ptr[i];
+    }
+
+    // Reply TLV layout: Data type(1) + 0xFD len(2), Name, Content
+    // type(1) + 0xFD len(2), content bytes
+    __u32 ndn_len = 4 + name_size + 4 + content_size;
+    __u32 new_frame = ndn_off + ndn_len;
+
+    // Content is copied in 64-byte blocks, so grow the frame to a padded
+    // size first - the last block then always has room - and trim the
+    // padding back off once the copy is done
+    __u32 padded = (content_size + 63) & ~63U;
+    __u32 padded_frame = ndn_off + 4 + name_size + 4 + padded;
+    __u32 old_frame = data_end - data;
+
+    if (bpf_xdp_adjust_tail(ctx, (int)padded_frame - (int)old_frame) < 0)
+        return -1;
+
+    data = (void *)(long)ctx->data;
+    data_end = (void *)(long)ctx->data_end;
+
+    // Data TLV header (2-byte extended length keeps offsets fixed)
+    __u16 inner_len = name_size + 4 + content_size;
+    __u8 *out = data + ndn_off;
+    if ((void *)(out + 4) > data_end)
+        return XDP_DROP;
+    out[0] = NDN_DATA;
+    out[1] = NDN_TLV_LEN_1BYTE_VAL;
+    out[2] = inner_len >> 8;
+    out[3] = inner_len & 0xFF;
+
+    // Echo the Interest Name
+    __u8 *name_out = data + ndn_off + 4;
+    #pragma unroll
+    for (int i = 0; i < REPLY_NAME_MAX; i++) {
+        if (i >= name_size)
+            break;
+        if ((void *)(name_out + i + 1) > data_end)
+            return XDP_DROP;
+        name_out[i] = name_buf[i];
+    }
+
+    // Content TLV header
+    __u32 chdr_off = ndn_off + 4 + name_size;
+    __u8 *chdr = data + chdr_off;
+    if ((void *)(chdr + 4) > data_end)
+        return XDP_DROP;
+    chdr[0] = NDN_TLV_CONTENT;
+    chdr[1] = NDN_TLV_LEN_1BYTE_VAL;
+    chdr[2] = content_size >> 8;
+    chdr[3] = content_size & 0xFF;
+
+    // Copy the cached content in 64-byte blocks
+    __u32 content_off = chdr_off + 4;
+    #pragma unroll
+    for (int i = 0; i < CS_MAX_CONTENT_SIZE / 64; i++) {
+        if ((__u32)(i * 64) >= content_size)
+            break;
+
+        __u8 *dst = data + content_off + (i * 64);
+        if ((void *)(dst + 64) > data_end)
+            return XDP_DROP;
+
+        __builtin_memcpy(dst, &entry->content[i * 64], 64);
+    }
+
+    // Trim the copy padding back off
+    if (padded != content_size) {
+        if (bpf_xdp_adjust_tail(ctx, -(int)(padded - content_size)) < 0)
+            return XDP_DROP;
+        data = (void *)(long)ctx->data;
+        data_end = (void *)(long)ctx->data_end;
+    }
+
+    // Turn the headers around for the TX path
+    eth = data;
+    if ((void *)(eth + 1) > data_end)
+        return XDP_DROP;
+
+    __u8 tmp_mac[ETH_ALEN];
+    __builtin_memcpy(tmp_mac, eth->h_source, ETH_ALEN);
+    __builtin_memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+    __builtin_memcpy(eth->h_dest, tmp_mac, ETH_ALEN);
+
+    if (is_udp) {
+        struct iphdr *ip = (struct iphdr *)(eth + 1);
+        if ((void *)(ip + 1) > data_end)
+            return XDP_DROP;
+        struct udphdr *udp = (struct udphdr *)(ip + 1);
+        if ((void *)(udp + 1) > data_end)
+            return XDP_DROP;
+
+        __u32 tmp_addr = ip->saddr;
+        ip->saddr = ip->daddr;
+        ip->daddr = tmp_addr;
+        ip->tot_len = bpf_htons((__u16)(new_frame - sizeof(struct ethhdr)));
+        ip->ttl = 64;
+        ip->check = 0;
+        ip->check = ip_fast_csum(ip);
+
+        __u16 tmp_port = udp->source;
+        udp->source = udp->dest;
+        udp->dest = tmp_port;
+        udp->len = bpf_htons((__u16)(ndn_len + sizeof(struct udphdr)));
+        udp->check = 0;  // UDP checksum is optional over IPv4
+    }
+
+    return XDP_TX;
+}
+
+// Rewrite a dropped Interest into a network NACK and bounce it back out
+// the ingress interface. Without this a consumer whose Interest was
+// shed (rate limit, duplicate nonce, no forwarding state) hears
+// nothing and waits out its full lifetime before retrying; the NACK
+// lets it fail fast and try an alternate path immediately.
+//
+// Same rewrite-in-place scheme as serve_data_from_cache above: capture
+// the Name on the stack, resize the frame with bpf_xdp_adjust_tail,
+// emit NACK type + 2-byte extended length, the echoed Name and a
+// one-byte NackReason TLV, then turn the headers around for XDP_TX.
+//
+// Returns XDP_TX on success, -1 if the frame was left untouched (the
+// caller falls back to a plain drop) and XDP_DROP if the frame was
+// already resized when a later step failed.
+static __always_inline int synthesize_nack(struct xdp_md *ctx,
+                                       __u32 pkt_offset, __u32 name_size,
+                                       __u8 reason) {
+    void *data = (void *)(long)ctx->data;
+    void *data_end = (void *)(long)ctx->data_end;
+
+    if (name_size < 2 || name_size > REPLY_NAME_MAX)
+        return -1;
+
+    // Detect UDP/IP vs direct Ethernet framing before touching anything
+    // and anchor the NACK at the start of the NDN payload, as in
+    // serve_data_from_cache
+    struct ethhdr *eth = data;
+    if ((void *)(eth + 1) > data_end)
+        return -1;
+    int is_udp = (bpf_ntohs(eth->h_proto) == ETH_P_IP);
+    __u32 ndn_off = sizeof(struct ethhdr);
+
+    if (is_udp) {
+        struct iphdr *ip = (struct iphdr *)(eth + 1);
+        if ((void *)(ip + 1) > data_end)
+            return -1;
+        // Only rewrite option-less IPv4 headers in kernel
+        if (ip->ihl != 5)
+            return -1;
+        struct udphdr *udp = (struct udphdr *)(ip + 1);
+        if ((void *)(udp + 1) > data_end)
+            return -1;
+        ndn_off += sizeof(struct iphdr) + sizeof(struct udphdr);
+    }
+
+    // Capture the Interest Name on the stack (the complete Name TLV,
+    // since pkt_offset points at its type byte) - bpf_xdp_adjust_tail
+    // invalidates all packet pointers
+    __u8 name_buf[REPLY_NAME_MAX];
+    __u8 *name_ptr = data + pkt_offset;
+    #pragma unroll
+    for (int i = 0; i < REPLY_NAME_MAX; i++) {
+        if (i >= name_size)
+            break;
+        if ((void *)(name_ptr + i + 1) > data_end)
+            return -1;
+        name_buf[i] = name_ptr[i];
+    }
+
+    // NACK TLV layout: type(1) + 0xFD len(2), Name, NackReason
+    // type(1) + len(1) + reason(1)
+    __u32 ndn_len = 4 + name_size + 3;
+    __u32 new_frame = ndn_off + ndn_len;
+    __u32 old_frame = data_end - data;
+
+    if (bpf_xdp_adjust_tail(ctx, (int)new_frame - (int)old_frame) < 0)
+        return -1;
+
+    data = (void *)(long)ctx->data;
+    data_end = (void *)(long)ctx->data_end;
+
+    // NACK TLV header (2-byte extended length keeps offsets fixed)
+    __u16 inner_len = name_size + 3;
+    __u8 *out = data + ndn_off;
+    if ((void *)(out + 4) > data_end)
+        return XDP_DROP;
+    out[0] = NDN_NACK;
+    out[1] = NDN_TLV_LEN_1BYTE_VAL;
+    out[2] = inner_len >> 8;
+    out[3] = inner_len & 0xFF;
+
+    // Echo the Interest Name
+    __u8 *name_out = data + ndn_off + 4;
+    #pragma unroll
+    for (int i = 0; i < REPLY_NAME_MAX; i++) {
+        if (i >= name_size)
+            break;
+        if ((void *)(name_out + i + 1) > data_end)
+            return XDP_DROP;
+        name_out[i] = name_buf[i];
+    }
+
+    // NackReason TLV
+    __u8 *rhdr = data + ndn_off + 4 + name_size;
+    if ((void *)(rhdr + 3) > data_end)
+        return XDP_DROP;
+    rhdr[0] = NDN_TLV_NACK_REASON;
+    rhdr[1] = 1;
+    rhdr[2] = reason;
+
+    // Turn the headers around for the TX path
+    eth = data;
+    if ((void *)(eth + 1) > data_end)
+        return XDP_DROP;
+
+    __u8 tmp_mac[ETH_ALEN];
+    __builtin_memcpy(tmp_mac, eth->h_source, ETH_ALEN);
+    __builtin_memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+    __builtin_memcpy(eth->h_dest, tmp_mac, ETH_ALEN);
+
+    if (is_udp) {
+        struct iphdr *ip = (struct iphdr *)(eth + 1);
+        if ((void *)(ip + 1) > data_end)
+            return XDP_DROP;
+        struct udphdr *udp = (struct udphdr *)(ip + 1);
+        if ((void *)(udp + 1) > data_end)
+            return XDP_DROP;
+
+        __u32 tmp_addr = ip->saddr;
+        ip->saddr = ip->daddr;
+        ip->daddr = tmp_addr;
+        ip->tot_len = bpf_htons((__u16)(new_frame - sizeof(struct ethhdr)));
+        ip->ttl = 64;
+        ip->check = 0;
+        ip->check = ip_fast_csum(ip);
+
+        __u16 tmp_port = udp->source;
+        udp->source = udp->dest;
+        udp->dest = tmp_port;
+        udp->len = bpf_htons((__u16)(ndn_len + sizeof(struct udphdr)));
+        udp->check = 0;  // UDP checksum is optional over IPv4
+    }
+
+    update_metric(METRIC_NACKS_SENT);
+    return XDP_TX;
+}
+
+// Store oversized content across fixed-size chunks in the chunked store
+// Uses the same two-step pattern as the single-entry store: insert a
+// header-only entry, look it up, then copy the payload slice into the
+// map-resident value with bpf_xdp_load_bytes, which walks the frame's
+// fragments - exactly the jumbo Data this store exists for rarely fits
+// the linear head. The descriptor is published last so a concurrent
+// lookup never sees chunks that aren't in place yet.
+static __always_inline int store_chunked_content(struct xdp_md *ctx, __u32 content_offset,
+                                             __u32 content_size, __u64 name_hash,
+                                             struct xdp_config_v2 *cfg) {
+    if (content_size > CS_CHUNK_SIZE * CS_MAX_CHUNKS)
+        return -1;  // Too large even for the chunked store
+
+    __u16 chunk_count = (content_size + CS_CHUNK_SIZE - 1) / CS_CHUNK_SIZE;
+
+    struct cs_chunk_key key = {
+        .name_hash = name_hash,
+        .chunk_idx = 0,
+        .reserved = 0
+    };
+    struct cs_chunk tmp_chunk;
+
+    #pragma unroll
+    for (int i = 0; i < CS_MAX_CHUNKS; i++) {
+        if (i >= chunk_count)
+            break;
+
+        __u32 chunk_size = content_size - (i * CS_CHUNK_SIZE);
+        if (chunk_size > CS_CHUNK_SIZE)
+            chunk_size = CS_CHUNK_SIZE;
+
+        key.chunk_idx = i;
+        tmp_chunk.chunk_size = chunk_size;
+        tmp_chunk.reserved = 0;
+
+        if (bpf_map_update_elem(&cs_chunk_store, &key, &tmp_chunk, BPF_ANY) != 0)
+            return -1;
+
+        struct cs_chunk *stored = bpf_map_lookup_elem(&cs_chunk_store, &key);
+        if (!stored)
+            return -1;
+
+        if (bpf_xdp_load_bytes(ctx, content_offset + (i * CS_CHUNK_SIZE),
+                               stored->content, chunk_size) != 0)
+            return -1;
+    }
+
+    // All chunks in place - publish the descriptor
+    struct cs_chunk_desc desc = {
+        .name_hash = name_hash,
+        .insertion_time = get_timestamp_sec(),
+        .expiry_time = cfg->default_ttl,
+        .total_size = content_size,
+        .chunk_count = chunk_count,
+        .content_type = 0,
+        .flags = 0
+    };
+
+    return bpf_map_update_elem(&cs_chunk_index, &name_hash, &desc, BPF_ANY);
+}
+
+
+// Sentinel returned by stage bodies that did not reach a terminal
+// verdict - the caller then tail-calls the next stage
+#define PIPELINE_CONTINUE -1
+
+// Content store stage for Interests: serve from the single-entry or
+// chunked store, or fall through to the forward stage on a miss
+static __always_inline int interest_cs_stage(struct xdp_md *ctx,
+                                         struct pipeline_state *st,
+                                         struct xdp_config_v2 *cfg) {
+#if !NDN_ROLE_HANDLES_INTEREST
+    // Data-only build: Interests never enter the pipeline, so this
+    // stage compiles down to nothing
+    return XDP_PASS;
+#else
+    __u64 name_hash = st->name_hash;
+    __u64 start_time = st->start_time;
+    __u8 action;
+
+    // Look up the active generation of the map-in-map content store
+    void *cs = cs_active();
+    struct cs_entry_v2 *entry = cs ? bpf_map_lookup_elem(cs, &name_hash) : NULL;
+
+    // Hash collision check: a hit only counts if the stored name
+    // length and prefix match this Interest's name
+    if (entry && !cs_name_matches(ctx, entry, st->pkt_offset, st->name_size))
+        entry = NULL;
+
+    if (entry && !content_expired(entry)) {
+        // We have valid content in our store
+        update_metric(METRIC_CACHE_HITS);
+
+        // Create Data packet from the cache, but only if it's small enough
+        if (entry->content_size <= cfg->cs_max_size) {
+            // Synthesize the Data reply in kernel and bounce it straight
+            // back out the ingress interface - a hit served here never
+            // leaves the driver layer
+            int ret = serve_data_from_cache(ctx, entry, st->pkt_offset, st->name_size);
+            if (ret == XDP_TX) {
                 action = DECISION_SERVE;
                 send_event(EVENT_CACHE_HIT, name_hash, entry->content_size, action, start_time);
-                return XDP_PASS;  // Signal userspace to serve from cache
+                return XDP_TX;
+            }
+            if (ret == XDP_DROP) {
+                // The frame was already resized when the rewrite failed,
+                // so it is no longer a valid Interest - drop it
+                update_metric(METRIC_ERRORS);
+                return XDP_DROP;
             }
-        } else {
-            update_metric(METRIC_CACHE_MISSES);
+
+            // Name too long or exotic framing - userspace serves it
+            action = DECISION_SERVE;
+            send_event(EVENT_CACHE_HIT, name_hash, entry->content_size, action, start_time);
+            return fallback_to_userspace(ctx);  // Signal userspace to serve from cache
+        }
+    } else {
+        // Not in the single-entry store - check the chunked store for
+        // large objects that didn't fit in one cs_entry_v2
+        struct cs_chunk_desc *desc = bpf_map_lookup_elem(&cs_chunk_index, &name_hash);
+
+        if (desc && !chunk_desc_expired(desc) &&
+            chunked_object_complete(name_hash, desc->chunk_count)) {
+            // All chunks are resident - serve from cache
+            update_metric(METRIC_CACHE_HITS);
+
+            // Reassembling the chunks into a Data packet is done in
+            // userspace, same as the single-entry serve path above
+            action = DECISION_SERVE;
+            send_event(EVENT_CACHE_HIT_CHUNKED, name_hash, desc->total_size,
+                      action, start_time);
+            return fallback_to_userspace(ctx);
         }
+
+        if (desc) {
+            // Expired, or some chunks were LRU-evicted - drop the
+            // descriptor so it doesn't count as a hit again
+            bpf_map_delete_elem(&cs_chunk_index, &name_hash);
+        }
+
+        update_metric(METRIC_CACHE_MISSES);
+    }
+
+    return PIPELINE_CONTINUE;
+#endif /* NDN_ROLE_HANDLES_INTEREST */
+}
+
+// Forward stage for Interests: nonce deduplication, PIT aggregation and
+// the final forwarding decision
+static __always_inline int interest_forward_stage(struct xdp_md *ctx,
+                                              struct pipeline_state *st,
+                                              struct xdp_config_v2 *cfg) {
+#if !NDN_ROLE_HANDLES_INTEREST
+    return XDP_PASS;
+#else
+    __u64 name_hash = st->name_hash;
+    __u64 start_time = st->start_time;
+    __u8 action = DECISION_PASS;
+
+    // Rate limit before any PIT or forwarding work: everything past this
+    // point either allocates PIT state or ends in XDP_PASS to the
+    // userspace transport, so this is the last cheap place to shed an
+    // Interest flood that missed the CS.
+    if (!interest_rate_allowed(name_hash)) {
+        // No per-packet event here: during a flood that would just move
+        // the overload into the ring buffer. The counter is enough.
+        update_metric(METRIC_RATELIMITED);
+
+        // Tell the consumer instead of silently eating the Interest -
+        // a congestion NACK lets it back off or try another path now
+        // rather than after its full Interest lifetime
+        int nack = synthesize_nack(ctx, st->pkt_offset, st->name_size,
+                                   NDN_NACK_CONGESTION);
+        if (nack >= 0)
+            return nack;
+        return XDP_DROP;
     }
-    
+
     // Check for duplicate Interests using nonce if available
     if (cfg->pit_enabled) {
         // Parse Interest to find nonce
         // This is a simplified version - we'd need more complex TLV parsing
         // to extract the nonce reliably, which is beyond the BPF verifier limits
-        
+
         // For simplicity in this prototype, we'll use name_hash + a random value as substitute
         // In a real implementation, we'd extract the actual nonce
         __u32 pseudo_nonce = (__u32)(name_hash & 0xFFFFFFFF);
-        
-        // Check if we've seen this nonce recently
-        __u64 *last_seen = bpf_map_lookup_elem(&nonce_cache, &pseudo_nonce);
-        if (last_seen) {
-            __u64 current_time = get_timestamp_ns();
-            // If we've seen this nonce in the last second, it's likely a duplicate
-            if (current_time - *last_seen < 1000000000ULL) {
-                update_metric(METRIC_DROPS);
-                action = DECISION_DROP;
-                send_event(EVENT_DUPLICATE_INTEREST, name_hash, ctx->data_end - ctx->data, 
-                          action, start_time);
-                return XDP_DROP;
+        __u64 current_time = get_timestamp_ns();
+
+        // Bloom filter front-end: most nonces are new and never touch
+        // the LRU at all; only bloom hits go through the confirm stage
+        if (nonce_bloom_maybe_seen(pseudo_nonce)) {
+            // Check if we've seen this nonce recently
+            __u64 *last_seen = bpf_map_lookup_elem(&nonce_cache, &pseudo_nonce);
+            if (last_seen) {
+                // If we've seen this nonce in the last second, it's likely a duplicate
+                if (current_time - *last_seen < 1000000000ULL) {
+                    update_metric(METRIC_DROPS);
+                    action = DECISION_DROP;
+                    send_event(EVENT_DUPLICATE_INTEREST, name_hash, bpf_xdp_get_buff_len(ctx),
+                              action, start_time);
+
+                    // A looped Interest came from somewhere - NACK it
+                    // so the sender prunes this path from its choices
+                    int nack = synthesize_nack(ctx, st->pkt_offset,
+                                               st->name_size,
+                                               NDN_NACK_DUPLICATE);
+                    if (nack >= 0)
+                        return nack;
+                    return XDP_DROP;
+                }
             }
+
+            // Only bloom-hit nonces are recorded in the LRU, so it now
+            // holds repeat candidates instead of every nonce on the wire
+            bpf_map_update_elem(&nonce_cache, &pseudo_nonce, &current_time, BPF_ANY);
         }
-        
-        // Update nonce cache
-        __u64 current_time = get_timestamp_ns();
-        bpf_map_update_elem(&nonce_cache, &pseudo_nonce, &current_time, BPF_ANY);
-        
-        // Create or update PIT entry
+
+        // Interest aggregation: if the name is already pending, record
+        // this face on the existing PIT entry and suppress the duplicate
+        // upstream Interest instead of forwarding N copies
+        struct pit_entry_v2 *pending = bpf_map_lookup_elem(&pit_v2, &name_hash);
+        if (pending) {
+            int known_face = 0;
+
+            #pragma unroll
+            for (int i = 0; i < PIT_MAX_FACES; i++) {
+                if (i >= pending->face_count)
+                    break;
+                if (pending->faces[i].ifindex == ctx->ingress_ifindex)
+                    known_face = 1;
+            }
+
+            // With the pseudo-nonce (derived from the name) every
+            // aggregation candidate carries the same nonce, so the
+            // per-face nonce only guards same-face retransmissions;
+            // real loop detection needs actual nonce extraction.
+            if (!known_face && pending->face_count < PIT_MAX_FACES) {
+                __u32 idx = pending->face_count;
+                if (idx < PIT_MAX_FACES) {
+                    pending->faces[idx].ifindex = ctx->ingress_ifindex;
+                    pending->faces[idx].nonce = pseudo_nonce;
+                    pending->face_count = idx + 1;
+                }
+            }
+
+            // The upstream Interest is already in flight - this copy is
+            // satisfied by the Data fan-out when it comes back
+            action = DECISION_DROP;
+            send_event(EVENT_INTEREST_PROCESSED, name_hash,
+                      bpf_xdp_get_buff_len(ctx), action, start_time);
+            return XDP_DROP;
+        }
+
+        // Create PIT entry with this interface as the first pending face
         struct pit_entry_v2 pit_entry = {
             .name_hash = name_hash,
             .arrival_time = current_time,
             .lifetime_ms = 4000, // Default 4 seconds lifetime
             .ingress_ifindex = ctx->ingress_ifindex,
             .nonce = pseudo_nonce,
-            .hop_count = 0
+            .hop_count = 0,
+            .face_count = 1
         };
-        
-        bpf_map_update_elem(&pit_v2, &name_hash, &pit_entry, BPF_ANY);
+        pit_entry.faces[0].ifindex = ctx->ingress_ifindex;
+        pit_entry.faces[0].nonce = pseudo_nonce;
+
+        if (bpf_map_update_elem(&pit_v2, &name_hash, &pit_entry, BPF_ANY) != 0) {
+            // PIT exhausted: the returning Data would be dropped as
+            // unsolicited anyway, so forwarding is pointless - NACK
+            // the Interest and let the consumer retry once pending
+            // entries have drained
+            update_metric(METRIC_DROPS);
+            int nack = synthesize_nack(ctx, st->pkt_offset, st->name_size,
+                                       NDN_NACK_NO_ROUTE);
+            if (nack >= 0)
+                return nack;
+            return XDP_DROP;
+        }
+
+        // Arm the expiry timer on the entry now in the map (timers can
+        // only be initialized on map-resident values). If it is never
+        // satisfied, pit_expire_cb deletes it at exactly the deadline.
+        struct pit_entry_v2 *inserted = bpf_map_lookup_elem(&pit_v2, &name_hash);
+        if (inserted &&
+            bpf_timer_init(&inserted->timer, &pit_v2, CLOCK_MONOTONIC) == 0 &&
+            bpf_timer_set_callback(&inserted->timer, pit_expire_cb) == 0)
+            bpf_timer_start(&inserted->timer,
+                            (__u64)inserted->lifetime_ms * 1000000ULL, 0);
     }
-    
+
     // Determine if we should handle in userspace or make a direct forwarding decision
     // This implements a probabilistic fallback to userspace to avoid overwhelming it
     if (bpf_get_prandom_u32() % 100 < cfg->userspace_fallback_threshold) {
         // Let userspace handle some percentage of the traffic
         action = DECISION_PASS;
-        send_event(EVENT_USERSPACE_FALLBACK, name_hash, ctx->data_end - ctx->data, 
+        send_event(EVENT_USERSPACE_FALLBACK, name_hash, bpf_xdp_get_buff_len(ctx),
                   action, start_time);
-        return XDP_PASS;
+        return fallback_to_userspace(ctx);
     }
-    
+
     // In a full implementation, we'd check the FIB here and potentially redirect
     // For now, we'll just pass to userspace
-    send_event(EVENT_INTEREST_PROCESSED, name_hash, ctx->data_end - ctx->data, 
+    send_event(EVENT_INTEREST_PROCESSED, name_hash, bpf_xdp_get_buff_len(ctx),
               action, start_time);
-    
-    return XDP_PASS;
+
+    return fallback_to_userspace(ctx);
+#endif /* NDN_ROLE_HANDLES_INTEREST */
 }
 
-// Process Data packet with optimized content store
-static __always_inline int process_data_v2(struct xdp_md *ctx, void *data, 
-                                       __u32 pkt_offset, struct xdp_config_v2 *cfg) {
-    void *data_end = (void *)(long)ctx->data_end;
-    __u64 name_hash;
-    __u32 name_size;
-    __u64 start_time = get_timestamp_ns();
-    __u8 action = DECISION_PASS;  // Default action
-    
-    // Get Data Name and compute hash
-    if (fast_hash_ndn_name(ctx, data, pkt_offset, &name_hash, &name_size) < 0) {
-        update_metric(METRIC_ERRORS);
-        return XDP_PASS;  // Let userspace handle malformed packets
-    }
-    
-    update_metric(METRIC_DATA_RECV);
-    
-    // Check if we have a PIT entry for this Data
+// Content store stage for Data: drop unsolicited Data, then cache the
+// content (single-entry or chunked) and continue to the forward stage
+static __always_inline int data_cs_stage(struct xdp_md *ctx, void *data,
+                                     struct pipeline_state *st,
+                                     struct xdp_config_v2 *cfg) {
+#if !NDN_ROLE_HANDLES_DATA
+    // Interest-only build: Data never enters the pipeline
+    return XDP_PASS;
+#else
+    __u64 name_hash = st->name_hash;
+    __u64 start_time = st->start_time;
+    __u8 action = DECISION_PASS;
+
+    // The unsolicited check must precede caching, so it lives here even
+    // though the rest of the PIT handling is in the forward stage
     if (cfg->pit_enabled) {
-        struct pit_entry_v2 *pit_entry = bpf_map_lookup_elem(&pit_v2, &name_hash);
-        
-        if (!pit_entry) {
+        if (!bpf_map_lookup_elem(&pit_v2, &name_hash)) {
             // No PIT entry, this is unsolicited Data
             update_metric(METRIC_DROPS);
             action = DECISION_DROP;
-            send_event(EVENT_UNSOLICITED_DATA, name_hash, ctx->data_end - ctx->data, 
+            send_event(EVENT_UNSOLICITED_DATA, name_hash, bpf_xdp_get_buff_len(ctx),
                       action, start_time);
             return XDP_DROP;
         }
-        
-        // Store content in CS if enabled
-        if (cfg->cs_enabled) {
-            // Skip over the name to find metadata and content
-            __u32 curr_offset = pkt_offset + name_size;
-            __u32 content_offset = 0;
-            __u32 content_size = 0;
-            
-            // In a real implementation, we'd parse the TLV structure to find the content
-            // This is simplified for the prototype
-            
-            // Use a fixed size for this prototype
-            content_size = 1024;  // Placeholder
-            content_offset = curr_offset + 8;  // Placeholder
-            
-            // Check if content is small enough to store
-            __u32 packet_size = ctx->data_end - ctx->data;
-            if (content_size <= cfg->cs_max_size && 
-                content_offset + content_size <= packet_size) {
-                
-                // Create content store entry
-                struct cs_entry_v2 *new_entry;
-                struct cs_entry_v2 tmp_entry;
-                
-                // Initialize the temporary entry
-                tmp_entry.name_hash = name_hash;
-                tmp_entry.insertion_time = get_timestamp_sec();
-                tmp_entry.expiry_time = cfg->default_ttl;
-                tmp_entry.content_size = content_size;
-                tmp_entry.content_type = 0;  // Default content type
-                tmp_entry.flags = 0;
-                
-                // Copy content data from packet to entry
-                __u8 *content_ptr = data + content_offset;
-                
-                // We can't use a variable length as an array index in the kernel
-                // So we'll hard code the maximum - the verifier will then check this
-                if (content_size > CS_MAX_CONTENT_SIZE)
-                    content_size = CS_MAX_CONTENT_SIZE;
-                
-                // Create properly sized content store entry
-                int ret = bpf_map_update_elem(&content_store_v2, &name_hash, &tmp_entry, BPF_ANY);
+    }
+
+    // Frequency-gated admission: bump the doorkeeper for this name and
+    // only insert once it has been requested cs_admission_threshold
+    // times within the window (0/1 = cache everything). Bypassed Data
+    // still forwards normally - only the cache insert is skipped, so
+    // one-hit wonders can't churn the resident working set out of the
+    // LRU.
+    if (cfg->cs_admission_threshold > 1) {
+        if (doorkeeper_update(name_hash) < cfg->cs_admission_threshold) {
+            update_metric(METRIC_CS_BYPASSED);
+            return PIPELINE_CONTINUE;
+        }
+        update_metric(METRIC_CS_ADMITTED);
+    }
+
+    // Walk the TLVs after the Name to find the Content block, skipping
+    // MetaInfo and anything else in between. The TLV headers sit in the
+    // linear head even on multi-buffer frames; only the content value
+    // itself extends into the fragments.
+    void *data_end = (void *)(long)ctx->data_end;
+    __u32 curr_offset = st->pkt_offset + st->name_size;
+    __u32 content_offset = 0;
+    __u32 content_size = 0;
+
+    #pragma unroll
+    for (int i = 0; i < 4; i++) {
+        __u32 tlv_type;
+        __u64 tlv_len;
+
+        if (fast_parse_tlv_type(data, data_end, &curr_offset, &tlv_type) < 0 ||
+            fast_parse_tlv_length(data, data_end, &curr_offset, &tlv_len) < 0)
+            break;
+
+        if (tlv_type == NDN_TLV_CONTENT) {
+            if (tlv_len > CS_CHUNK_SIZE * CS_MAX_CHUNKS)
+                break;  // Too large even for the chunked store
+            content_offset = curr_offset;
+            content_size = tlv_len;
+            break;
+        }
+
+        curr_offset += tlv_len;
+    }
+
+    // No Content TLV (or nothing cacheable) - forward without caching
+    if (content_size == 0)
+        return PIPELINE_CONTINUE;
+
+    // Check if content is small enough to store. The size check runs
+    // against the full multi-buffer frame length, not just the linear
+    // head - jumbo Data carries most of its payload in the fragments.
+    __u32 packet_size = bpf_xdp_get_buff_len(ctx);
+    if (content_size <= cfg->cs_max_size &&
+        content_offset + content_size <= packet_size) {
+
+        // Create content store entry
+        struct cs_entry_v2 *new_entry;
+        struct cs_entry_v2 tmp_entry;
+
+        // Initialize the temporary entry
+        tmp_entry.name_hash = name_hash;
+        tmp_entry.insertion_time = get_timestamp_sec();
+        tmp_entry.expiry_time = cfg->default_ttl;
+        tmp_entry.content_size = content_size;
+        tmp_entry.content_type = 0;  // Default content type
+        tmp_entry.flags = 0;
+
+        // Record the name length and leading Name TLV bytes so lookups
+        // can reject 64-bit hash collisions in-kernel
+        tmp_entry.name_len = st->name_size;
+        __u8 *name_ptr = data + st->pkt_offset;
+        #pragma unroll
+        for (int i = 0; i < CS_NAME_PREFIX_LEN; i++) {
+            tmp_entry.name_prefix[i] = 0;
+            if ((__u32)i < st->name_size && name_ptr + i + 1 <= (__u8 *)data_end)
+                tmp_entry.name_prefix[i] = name_ptr[i];
+        }
+
+        // We can't use a variable length as an array index in the kernel
+        // So we'll hard code the maximum - the verifier will then check this
+        if (content_size > CS_MAX_CONTENT_SIZE)
+            content_size = CS_MAX_CONTENT_SIZE;
+
+        // Create properly sized content store entry in the active
+        // generation of the map-in-map store
+        void *cs = cs_active();
+        if (!cs)
+            return PIPELINE_CONTINUE;
+
+        int ret = bpf_map_update_elem(cs, &name_hash, &tmp_entry, BPF_ANY);
+        if (ret == 0) {
+            // Get the inserted entry so we can update the content
+            new_entry = bpf_map_lookup_elem(cs, &name_hash);
+            if (new_entry) {
+                // Copy the content data safely
+                // bpf_xdp_load_bytes walks the frame's fragments, so
+                // payload past the linear head is copied too
+                ret = bpf_xdp_load_bytes(ctx, content_offset,
+                                         new_entry->content, content_size);
                 if (ret == 0) {
-                    // Get the inserted entry so we can update the content
-                    new_entry = bpf_map_lookup_elem(&content_store_v2, &name_hash);
-                    if (new_entry) {
-                        // Copy the content data safely
-                        // Use bpf_probe_read to safely copy from the packet data
-                        // This is a workaround for the eBPF verifier limitations
-                        ret = bpf_probe_read(new_entry->content, content_size, content_ptr);
-                        if (ret == 0) {
-                            update_metric(METRIC_CACHE_INSERTS);
-                            action = DECISION_PASS;
-                            send_event(EVENT_CONTENT_CACHED, name_hash, content_size, 
-                                      action, start_time);
-                        }
-                    }
+                    update_metric(METRIC_CACHE_INSERTS);
+                    send_event(EVENT_CONTENT_CACHED, name_hash, content_size,
+                              action, start_time);
                 }
             }
-            
+        }
+    } else if (content_offset + content_size <= packet_size) {
+        // Too large for a single entry - spread it across the
+        // chunked store instead of bypassing the cache entirely
+        if (store_chunked_content(ctx, content_offset, content_size,
+                                  name_hash, cfg) == 0) {
+            update_metric(METRIC_CACHE_INSERTS);
+            send_event(EVENT_CONTENT_CACHED_CHUNKED, name_hash, content_size,
+                      action, start_time);
+        }
+    }
+
+    return PIPELINE_CONTINUE;
+#endif /* NDN_ROLE_HANDLES_DATA */
+}
+
+// Forward stage for Data: consume the PIT entry and fan the reply out
+// to the pending faces
+static __always_inline int data_forward_stage(struct xdp_md *ctx,
+                                          struct pipeline_state *st,
+                                          struct xdp_config_v2 *cfg) {
+#if !NDN_ROLE_HANDLES_DATA
+    return XDP_PASS;
+#else
+    __u64 name_hash = st->name_hash;
+    __u64 start_time = st->start_time;
+    __u8 action = DECISION_PASS;
+
+    if (cfg->pit_enabled) {
+        struct pit_entry_v2 *pit_entry = bpf_map_lookup_elem(&pit_v2, &name_hash);
+
+        if (pit_entry) {
+            // Snapshot the pending faces before the PIT entry is consumed
+            __u8 face_count = pit_entry->face_count;
+            __u32 first_face = 0;
+            if (face_count > 0)
+                first_face = pit_entry->faces[0].ifindex;
+
             // Delete PIT entry for satisfied Interest
             bpf_map_delete_elem(&pit_v2, &name_hash);
+
+            // Fan the Data out to the pending faces. XDP can only redirect a
+            // frame to a single target, so the common single-face case is
+            // returned in kernel; with multiple aggregated faces the frame
+            // goes to userspace, which replicates it per face.
+            if (face_count == 1 && first_face != 0 &&
+                first_face != ctx->ingress_ifindex) {
+                update_metric(METRIC_REDIRECTS);
+                action = DECISION_REDIRECT;
+                send_event(EVENT_DATA_PROCESSED, name_hash, bpf_xdp_get_buff_len(ctx),
+                          action, start_time);
+                return bpf_redirect(first_face, 0);
+            }
         }
     }
-    
+
     // Forward the Data packet using PIT information
-    // In a real implementation, we'd check the PIT entry's ingress interface
-    // and forward accordingly
-    send_event(EVENT_DATA_PROCESSED, name_hash, ctx->data_end - ctx->data, 
+    // Multi-face fan-out (and anything the kernel path could not return
+    // directly) is handled by userspace from here
+    send_event(EVENT_DATA_PROCESSED, name_hash, bpf_xdp_get_buff_len(ctx),
               action, start_time);
-    
-    return XDP_PASS;
+
+    return fallback_to_userspace(ctx);
+#endif /* NDN_ROLE_HANDLES_DATA */
 }
 
-SEC("xdp")
-int ndn_xdp_parser_v2(struct xdp_md *ctx) {
+// Pipeline stage: TLV parse + name hash
+// Reads the classify results from the per-CPU state, fills in the name
+// hash/size, then jumps to the CS stage.
+SEC("xdp.frags")
+int ndn_stage_parse(struct xdp_md *ctx) {
+    void *data = (void *)(long)ctx->data;
+    struct pipeline_state *st = get_pipeline_state();
+    struct xdp_config_v2 *cfg = get_config_v2();
+
+    if (!st || !cfg)
+        return XDP_PASS;
+
+    if (fast_hash_ndn_name(ctx, data, st->pkt_offset, &st->name_hash,
+                           &st->name_size) < 0) {
+        update_metric(METRIC_ERRORS);
+        return fallback_to_userspace(ctx);  // Let userspace handle malformed packets
+    }
+
+    if (st->pkt_type == NDN_INTEREST) {
+        update_metric(METRIC_INTERESTS_RECV);
+
+        // Per-prefix popularity: bump the count-min sketch and promote
+        // names whose estimate says they are heavy hitters
+        __u64 est = cms_update(st->name_hash);
+        if (est >= HH_PROMOTE_THRESHOLD)
+            hh_promote(ctx, st, est);
+    } else {
+        update_metric(METRIC_DATA_RECV);
+    }
+
+    // Name-hash CPU steering: hand the packet to the core that owns its
+    // slice of the name space, where ndn_cpumap_rx picks it up. The
+    // common case - this core already owns the name - falls through to
+    // the CS stage with no detour.
+    __u32 steer_key = 0;
+    __u32 *steer_cpus = bpf_map_lookup_elem(&cpu_steer_count, &steer_key);
+    if (steer_cpus && *steer_cpus > 0) {
+        __u32 slot = st->name_hash % *steer_cpus;
+        __u32 *cpu = bpf_map_lookup_elem(&cpu_steer_set, &slot);
+
+        if (cpu && *cpu != bpf_get_smp_processor_id())
+            return bpf_redirect_map(&cpu_steer, *cpu, 0);
+    }
+
+    bpf_tail_call(ctx, &prog_stages, STAGE_CS);
+
+    // Slot not wired (e.g. CS disabled and the loader jumped it straight
+    // to forward, which also covers this fall-through)
+    bpf_tail_call(ctx, &prog_stages, STAGE_FORWARD);
+    return fallback_to_userspace(ctx);
+}
+
+// Pipeline stage: content store lookup/serve (Interest) or store (Data)
+SEC("xdp.frags")
+int ndn_stage_cs(struct xdp_md *ctx) {
+    void *data = (void *)(long)ctx->data;
+    struct pipeline_state *st = get_pipeline_state();
+    struct xdp_config_v2 *cfg = get_config_v2();
+    int ret;
+
+    if (!st || !cfg)
+        return XDP_PASS;
+
+    if (st->pkt_type == NDN_INTEREST)
+        ret = interest_cs_stage(ctx, st, cfg);
+    else
+        ret = data_cs_stage(ctx, data, st, cfg);
+
+    if (ret != PIPELINE_CONTINUE)
+        return ret;
+
+    bpf_tail_call(ctx, &prog_stages, STAGE_FORWARD);
+    return fallback_to_userspace(ctx);
+}
+
+// Pipeline stage: nonce dedup, PIT and the forwarding decision
+SEC("xdp.frags")
+int ndn_stage_forward(struct xdp_md *ctx) {
+    struct pipeline_state *st = get_pipeline_state();
+    struct xdp_config_v2 *cfg = get_config_v2();
+
+    if (!st || !cfg)
+        return XDP_PASS;
+
+    if (st->pkt_type == NDN_INTEREST)
+        return interest_forward_stage(ctx, st, cfg);
+
+    return data_forward_stage(ctx, st, cfg);
+}
+
+// Parse the outer packet TLV header: the type, then the length field,
+// so *offset lands on the first inner TLV - the Name, which is what
+// the parse stage hashes
+static __always_inline int parse_outer_tlv(void *data, void *data_end,
+                                       __u32 *offset, __u32 *type) {
+    __u64 outer_len;
+
+    if (fast_parse_tlv_type(data, data_end, offset, type) < 0)
+        return -1;
+    if (fast_parse_tlv_length(data, data_end, offset, &outer_len) < 0)
+        return -1;
+    return 0;
+}
+
+// Identify NDN framing - raw NDN ethertype or NDN-over-UDP/IP - and
+// return the outer TLV type plus the offset of the Name TLV (the first
+// inner TLV, just past the outer type and length fields). Shared
+// between the attach-point classify stage and the CPU-steered re-entry
+// point below. Returns 0 when the frame carries an NDN packet, -1
+// otherwise.
+static __always_inline int classify_ndn_frame(struct xdp_md *ctx,
+                                          __u32 *offset, __u32 *type) {
     void *data = (void *)(long)ctx->data;
     void *data_end = (void *)(long)ctx->data_end;
+
+    // Ensure we can read the Ethernet header
+    struct ethhdr *eth = data;
+    if ((void *)(eth + 1) > data_end)
+        return -1;
+
+    // NDN direct Ethernet framing
+    if (bpf_ntohs(eth->h_proto) == NDN_ETHERTYPE) {
+        *offset = sizeof(struct ethhdr);
+        return parse_outer_tlv(data, data_end, offset, type);
+    }
+
+    // NDN over UDP/IP
+    if (bpf_ntohs(eth->h_proto) == ETH_P_IP) {
+        struct iphdr *ip = (struct iphdr *)(eth + 1);
+        if ((void *)(ip + 1) > data_end)
+            return -1;
+
+        if (ip->protocol != IPPROTO_UDP)
+            return -1;
+
+        struct udphdr *udp = (struct udphdr *)((void *)ip + (ip->ihl * 4));
+        if ((void *)(udp + 1) > data_end)
+            return -1;
+
+        if (bpf_ntohs(udp->dest) != NDN_UDP_PORT)
+            return -1;
+
+        *offset = sizeof(struct ethhdr) + (ip->ihl * 4) + sizeof(struct udphdr);
+        return parse_outer_tlv(data, data_end, offset, type);
+    }
+
+    return -1;
+}
+
+// CPU-steered re-entry point, attached to the cpu_steer entries by the
+// loader. A steered frame arrives here on the core that owns its name
+// slice; tail calls can't cross into the cpumap attach type, so the
+// remaining stages run inline (their bodies are shared with the
+// tail-call pipeline). Interests/Data were already counted and the
+// popularity sketch bumped on the RX core before the steer, so this
+// path must not count them again.
+SEC("xdp.frags/cpumap")
+int ndn_cpumap_rx(struct xdp_md *ctx) {
+    struct pipeline_state *st = get_pipeline_state();
+    struct xdp_config_v2 *cfg = get_config_v2();
+    __u32 offset = 0, type = 0;
+    int ret;
+
+    if (!st || !cfg)
+        return XDP_PASS;
+
+    if (classify_ndn_frame(ctx, &offset, &type) < 0)
+        return XDP_PASS;
+
+    if (!((NDN_ROLE_HANDLES_INTEREST && type == NDN_INTEREST) ||
+          (NDN_ROLE_HANDLES_DATA && type == NDN_DATA)))
+        return XDP_PASS;
+
+    st->pkt_offset = offset;
+    st->pkt_type = type;
+    st->start_time = get_timestamp_ns();
+    st->name_hash = 0;
+    st->name_size = 0;
+
+    void *data = (void *)(long)ctx->data;
+    if (fast_hash_ndn_name(ctx, data, st->pkt_offset, &st->name_hash,
+                           &st->name_size) < 0) {
+        update_metric(METRIC_ERRORS);
+        return fallback_to_userspace(ctx);
+    }
+
+    if (st->pkt_type == NDN_INTEREST) {
+        ret = interest_cs_stage(ctx, st, cfg);
+        if (ret == PIPELINE_CONTINUE)
+            ret = interest_forward_stage(ctx, st, cfg);
+    } else {
+        ret = data_cs_stage(ctx, data, st, cfg);
+        if (ret == PIPELINE_CONTINUE)
+            ret = data_forward_stage(ctx, st, cfg);
+    }
+
+    // XDP_TX is not a valid verdict in cpumap context - turn a bounce
+    // (cache hit or NACK) into an explicit redirect to the ingress port
+    if (ret == XDP_TX)
+        return bpf_redirect(ctx->ingress_ifindex, 0);
+
+    return ret;
+}
+
+// Attach point / classify stage: identify NDN framing, record the Name
+// offset and packet type in the per-CPU state, and enter the pipeline.
+// Each later stage runs as its own program with its own verifier budget.
+//
+// The whole pipeline is declared xdp.frags (BPF_F_XDP_HAS_FRAGS): on a
+// 9000-byte MTU fabric most Data packets arrive as multi-buffer frames,
+// and a non-frags program would never even be attached. Headers and
+// Name TLVs always sit in the linear head, so the direct-access TLV
+// walks stay as they are; payloads that extend into the fragments are
+// copied with bpf_xdp_load_bytes in the CS stage. Every program in the
+// tail-call chain must carry the flag, or the prog_array refuses them.
+SEC("xdp.frags")
+int ndn_xdp_parser_v2(struct xdp_md *ctx) {
     struct xdp_config_v2 *cfg;
+    struct pipeline_state *st;
+    __u32 offset = 0, type = 0;
     __u64 start_time = get_timestamp_ns();
-    
+
     // Get configuration - initialize if not already done
     cfg = get_config_v2();
     if (!cfg) {
@@ -219,69 +1063,33 @@ int ndn_xdp_parser_v2(struct xdp_md *ctx) {
         if (!cfg)
             return XDP_PASS; // Can't proceed without config
     }
-    
-    // Ensure we can read the Ethernet header
-    struct ethhdr *eth = data;
-    if ((void *)eth + sizeof(*eth) > data_end)
+
+    st = get_pipeline_state();
+    if (!st)
         return XDP_PASS;
-    
-    // Check for NDN direct Ethernet framing
-    if (bpf_ntohs(eth->h_proto) == NDN_ETHERTYPE) {
-        // Skip Ethernet header
-        __u32 offset = sizeof(struct ethhdr);
-        
-        // Parse NDN packet type
-        __u32 type;
-        if (fast_parse_tlv_type(data, data_end, &offset, &type) < 0)
-            return XDP_PASS;
-        
-        // Process based on NDN packet type
-        if (type == NDN_INTEREST)
-            return process_interest_v2(ctx, data, offset, cfg);
-        else if (type == NDN_DATA)
-            return process_data_v2(ctx, data, offset, cfg);
-        else if (type == NDN_NACK) {
-            update_metric(METRIC_NACKS_RECV);
-            // NACK handling would go here
-            return XDP_PASS;
-        }
+
+    // Not NDN or parsing failed - pass to the normal network stack
+    if (classify_ndn_frame(ctx, &offset, &type) < 0)
+        return XDP_PASS;
+
+    // Enter the pipeline based on NDN packet type. Off-role types
+    // (role-specialized builds) fall through to XDP_PASS without
+    // even being hashed.
+    if ((NDN_ROLE_HANDLES_INTEREST && type == NDN_INTEREST) ||
+        (NDN_ROLE_HANDLES_DATA && type == NDN_DATA)) {
+        st->pkt_offset = offset;
+        st->pkt_type = type;
+        st->start_time = start_time;
+        st->name_hash = 0;
+        st->name_size = 0;
+        bpf_tail_call(ctx, &prog_stages, STAGE_PARSE);
+        return XDP_PASS;  // Jump table not wired yet - degrade safely
     }
-    
-    // Check for NDN over UDP/IP
-    if (bpf_ntohs(eth->h_proto) == ETH_P_IP) {
-        struct iphdr *ip = (struct iphdr *)(eth + 1);
-        if ((void *)ip + sizeof(*ip) > data_end)
-            return XDP_PASS;
-        
-        // Check for UDP traffic
-        if (ip->protocol == IPPROTO_UDP) {
-            struct udphdr *udp = (struct udphdr *)((void *)ip + (ip->ihl * 4));
-            if ((void *)udp + sizeof(*udp) > data_end)
-                return XDP_PASS;
-            
-            if (bpf_ntohs(udp->dest) == NDN_UDP_PORT) {
-                // Skip UDP header
-                __u32 offset = sizeof(struct ethhdr) + (ip->ihl * 4) + sizeof(struct udphdr);
-                
-                // Parse NDN packet type
-                __u32 type;
-                if (fast_parse_tlv_type(data, data_end, &offset, &type) < 0)
-                    return XDP_PASS;
-                
-                // Process based on NDN packet type
-                if (type == NDN_INTEREST)
-                    return process_interest_v2(ctx, data, offset, cfg);
-                else if (type == NDN_DATA)
-                    return process_data_v2(ctx, data, offset, cfg);
-                else if (type == NDN_NACK) {
-                    update_metric(METRIC_NACKS_RECV);
-                    return XDP_PASS;
-                }
-            }
-        }
+    if (type == NDN_NACK) {
+        update_metric(METRIC_NACKS_RECV);
+        // NACK handling would go here
     }
-    
-    // Not NDN or parsing failed, just pass to normal network stack
+
     return XDP_PASS;
 }
 
@@ -0,0 +1,474 @@
+//
+// μDCN - Sockmap/SK_SKB NDN-over-TCP Front End
+//
+// XDP sees individual frames, so NDN-over-TCP traffic - which several
+// peers insist on - sails past the in-kernel content store entirely:
+// the TLV stream is reassembled by TCP and only materializes at the
+// socket layer. This companion program hooks that layer instead. A
+// stream parser frames complete NDN TLVs out of the byte stream (the
+// kernel strparser accumulates segments until a whole TLV is
+// available, so TLVs spanning segment boundaries are handled without
+// copies), and a stream verdict program computes the same name hash as
+// the XDP path and probes the shared content_store_v2. Cache hits are
+// flagged in per-socket state so the loader's TCP serve thread can
+// write the Data reply straight back to the peer socket from the CS
+// entry, bypassing all forwarder logic; synthesizing the reply fully
+// in-kernel is not possible from an sk_skb verdict, which can neither
+// grow the skb nor inject new data into the socket.
+//
+// The content store and metrics maps are NOT created here - the loader
+// reuses the fds of the XDP object's maps before loading this one, so
+// both data paths hit the same cache and the same counters.
+//
+
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+
+#include "ndn_tlv.h"  // Include the NDN TLV definitions
+
+// Content store settings - must stay in lockstep with ndn_parser_v2.c,
+// or the loader's fd reuse will fail the map compatibility check
+#define CS_MAX_ENTRIES 32768  // Increased capacity for in-kernel CS
+#define CS_MAX_CONTENT_SIZE 4096 // Increased max content size
+#define CS_NAME_PREFIX_LEN 22
+
+// Largest TLV the stream parser will frame. Anything bigger than the
+// chunked store can hold is treated as a desynchronized stream.
+#define TCP_MAX_TLV_LEN 65536
+
+// How much of each framed message the verdict pulls into the linear
+// area before parsing: outer TLV header plus a full-length Name.
+#define TCP_PARSE_PULL 300
+
+// Sockets tracked by the front end
+#define TCP_MAX_SOCKS 1024
+
+// Mirror of the content store entry in ndn_parser_v2.c
+struct cs_entry_v2 {
+    __u64 name_hash;          // Name hash (for quick validation)
+    __u64 insertion_time;     // When the content was inserted
+    __u32 expiry_time;        // Time to live in seconds
+    __u16 content_size;       // Size of the content
+    __u8 content_type;        // Content type from NDN packet
+    __u8 flags;               // Additional flags
+    __u16 name_len;           // Full Name TLV size (collision check)
+    __u8 name_prefix[CS_NAME_PREFIX_LEN];  // Leading Name TLV bytes
+    __u8 content[];           // Flexible array for content data
+};
+
+// Shared maps, declared identically to ndn_parser_v2.c. The loader
+// calls bpf_map__reuse_fd() on these before load, so the definitions
+// here only have to match - they never create a second copy.
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(__u64));
+    __uint(max_entries, METRIC_MAX);
+} metrics SEC(".maps");
+
+struct cs_store_inner {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(key_size, sizeof(__u64));    // 64-bit name hash
+    __uint(value_size, sizeof(struct cs_entry_v2) + CS_MAX_CONTENT_SIZE);
+    __uint(max_entries, CS_MAX_ENTRIES);
+} content_store_v2 SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, 1);
+    __uint(key_size, sizeof(__u32));     // Single active slot
+    __array(values, struct cs_store_inner);
+} content_store_map SEC(".maps") = {
+    .values = { &content_store_v2 },
+};
+
+// NDN-over-TCP sockets, keyed by socket cookie. The loader inserts
+// every accepted connection; the stream parser/verdict pair below is
+// attached to this map so only NDN sockets pay for the parsing.
+struct {
+    __uint(type, BPF_MAP_TYPE_SOCKHASH);
+    __uint(key_size, sizeof(__u64));     // Socket cookie
+    __uint(value_size, sizeof(__u32));
+    __uint(max_entries, TCP_MAX_SOCKS);
+} ndn_tcp_socks SEC(".maps");
+
+// Per-socket stream state, keyed by socket cookie. pending_hit carries
+// the verdict's CS lookup result to the loader's serve thread: when
+// the framed Interest arrives in userspace, the thread reads the hash
+// from here and serves the Data without re-parsing or re-hashing.
+struct tcp_stream_state {
+    __u64 pending_hit;        // Name hash of the last CS hit, 0 = none
+    __u64 msgs_framed;        // Complete TLVs delivered on this socket
+    __u64 resyncs;            // Times the stream lost TLV framing
+    __u64 cache_hits;         // CS hits on this socket
+    __u64 cache_misses;       // CS misses on this socket
+    __u64 bytes_tx;           // Egress bytes seen by the SK_MSG hook
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(key_size, sizeof(__u64));     // Socket cookie
+    __uint(value_size, sizeof(struct tcp_stream_state));
+    __uint(max_entries, TCP_MAX_SOCKS);
+} tcp_stream_state SEC(".maps");
+
+// Get current timestamp in seconds
+static __always_inline __u32 get_timestamp_sec(void) {
+    return (__u32)(bpf_ktime_get_ns() / 1000000000);
+}
+
+// Update a metric counter (shared with the XDP path)
+static __always_inline void update_metric(int metric_idx) {
+    __u32 key = metric_idx;
+    __u64 *value = bpf_map_lookup_elem(&metrics, &key);
+    if (value)
+        (*value)++;
+}
+
+// Resolve the currently active content store generation
+static __always_inline void *cs_active(void) {
+    __u32 slot = 0;
+    return bpf_map_lookup_elem(&content_store_map, &slot);
+}
+
+// Look up (and lazily create) the state slot for this socket
+static __always_inline struct tcp_stream_state *get_stream_state(__u64 cookie) {
+    struct tcp_stream_state *st = bpf_map_lookup_elem(&tcp_stream_state, &cookie);
+    if (st)
+        return st;
+
+    struct tcp_stream_state init = {};
+    bpf_map_update_elem(&tcp_stream_state, &cookie, &init, BPF_NOEXIST);
+    return bpf_map_lookup_elem(&tcp_stream_state, &cookie);
+}
+
+// Decode one TLV length (varint encoding) from linear skb data.
+// Returns the number of bytes the length field occupies, 0 if more
+// data is needed to decode it, or -1 on an invalid encoding.
+static __always_inline int tcp_parse_tlv_length(__u8 *data, __u8 *data_end,
+                                                __u32 offset, __u64 *length) {
+    __u8 *p = data + offset;
+
+    if (p + 1 > data_end)
+        return 0;
+
+    if (p[0] < NDN_TLV_LEN_1BYTE_VAL) {
+        *length = p[0];
+        return 1;
+    }
+
+    if (p[0] == NDN_TLV_LEN_1BYTE_VAL) {
+        if (p + 3 > data_end)
+            return 0;
+        *length = ((__u64)p[1] << 8) | p[2];
+        return 3;
+    }
+
+    if (p[0] == NDN_TLV_LEN_2BYTE_VAL) {
+        if (p + 5 > data_end)
+            return 0;
+        *length = ((__u64)p[1] << 24) | ((__u64)p[2] << 16) |
+                  ((__u64)p[3] << 8) | p[4];
+        return 5;
+    }
+
+    // 8-byte lengths can't describe anything we'd frame
+    return -1;
+}
+
+// xxhash over the Name TLV value, byte-for-byte identical to xxhash()
+// in ndn_parser_v2.c - both paths must derive the same CS key from the
+// same name. Inputs here are always linear (the verdict pulls the head
+// of the message first), so the block loop indexes plain pointers
+// instead of re-deriving the packet from the context per iteration.
+#define MAX_NAME_LEN 256
+
+struct skb_xxhash_loop_ctx {
+    __u8 *data;          // First byte of the hashed region
+    __u8 *data_end;
+    __u32 block_count;   // Number of 8-byte blocks to process
+    __u64 h64;           // Running hash state
+};
+
+static int skb_xxhash_block_body(__u32 index, void *arg) {
+    const __u64 PRIME64_1 = 11400714785074694791ULL;
+    const __u64 PRIME64_2 = 14029467366897019727ULL;
+    const __u64 PRIME64_4 = 9650029242287828579ULL;
+    struct skb_xxhash_loop_ctx *c = arg;
+
+    if (index >= c->block_count)
+        return 1;
+
+    __u8 *p = c->data + index * 8;
+    if (p + 8 > c->data_end)
+        return 1;
+
+    __u64 k1 = *(__u64 *)p;
+    c->h64 ^= k1 * PRIME64_2;
+    c->h64 = ((c->h64 << 31) | (c->h64 >> 33)) * PRIME64_1;
+    c->h64 = c->h64 * PRIME64_1 + PRIME64_4;
+
+    return 0;
+}
+
+static __always_inline __u64 skb_xxhash(__u8 *data, __u32 length,
+                                        __u64 seed, __u8 *data_end) {
+    const __u64 PRIME64_1 = 11400714785074694791ULL;
+    const __u64 PRIME64_2 = 14029467366897019727ULL;
+    const __u64 PRIME64_3 = 1609587929392839161ULL;
+    const __u64 PRIME64_5 = 2870177450012600261ULL;
+
+    __u64 h64;
+
+    // Safety check
+    if (data + length > data_end)
+        length = data_end - data;
+    if (length > MAX_NAME_LEN)
+        length = MAX_NAME_LEN;
+
+    if (length >= 32) {
+        struct skb_xxhash_loop_ctx loop_ctx = {
+            .data = data,
+            .data_end = data_end,
+            .block_count = length / 8,
+            .h64 = seed + PRIME64_5,
+        };
+
+        bpf_loop(MAX_NAME_LEN / 8, skb_xxhash_block_body, &loop_ctx, 0);
+        h64 = loop_ctx.h64;
+
+        // Process the remaining tail bytes
+        __u32 tail = (length / 8) * 8;
+        #pragma unroll
+        for (int i = 0; i < 7; i++) {
+            if (tail + i >= length) break;
+            if (data + tail + i + 1 > data_end) break;
+
+            h64 ^= (__u64)data[tail + i] * PRIME64_5;
+            h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
+        }
+
+        h64 += length;
+    }
+    else if (length >= 16) {
+        h64 = seed + PRIME64_5;
+
+        if (data + 8 > data_end) goto fallback;
+        __u64 k1 = *(__u64 *)(data);
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
+
+        if (data + 16 > data_end) goto partial_second_block;
+        k1 = *(__u64 *)(data + 8);
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
+
+        partial_second_block:
+        h64 += length;
+    }
+    else if (length >= 8) {
+        h64 = seed + PRIME64_5;
+
+        if (data + 8 > data_end) goto fallback;
+        __u64 k1 = *(__u64 *)(data);
+        h64 ^= k1 * PRIME64_2;
+        h64 = ((h64 << 31) | (h64 >> 33)) * PRIME64_1;
+        h64 += length;
+    }
+    else {
+        fallback:
+        h64 = seed + PRIME64_5;
+
+        #pragma unroll
+        for (int i = 0; i < 8; i++) {
+            if (i >= length) break;
+            if (data + i > data_end) break;
+
+            h64 ^= (__u64)data[i] * PRIME64_5;
+            h64 = ((h64 << 11) | (h64 >> 53)) * PRIME64_1;
+        }
+
+        h64 += length;
+    }
+
+    // Finalization
+    h64 ^= h64 >> 33;
+    h64 *= PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME64_3;
+    h64 ^= h64 >> 32;
+
+    return h64;
+}
+
+// Check if a content store entry has expired (same rule as XDP path)
+static __always_inline int content_expired(struct cs_entry_v2 *entry) {
+    __u32 now = get_timestamp_sec();
+    return (now >= (entry->insertion_time + entry->expiry_time));
+}
+
+// Stream parser: report the byte length of the next complete NDN TLV.
+// The strparser core accumulates segments until that many bytes are
+// available and only then runs the verdict, so a TLV split across any
+// number of TCP segments arrives there as one contiguous message.
+// Returning 0 asks for more data when even the TLV header is split.
+SEC("sk_skb/stream_parser")
+int ndn_tcp_stream_parser(struct __sk_buff *skb)
+{
+    // Linearize the worst-case TLV header: type(1) + 0xFE len(5)
+    bpf_skb_pull_data(skb, 6);
+
+    __u8 *data = (__u8 *)(long)skb->data;
+    __u8 *data_end = (__u8 *)(long)skb->data_end;
+
+    if (data + 1 > data_end)
+        return 0;
+
+    __u8 type = data[0];
+    if (type != NDN_INTEREST && type != NDN_DATA && type != NDN_NACK) {
+        // Lost TLV framing - flush the buffered bytes so the stream
+        // can resynchronize on the next segment boundary
+        __u64 cookie = bpf_get_socket_cookie(skb);
+        struct tcp_stream_state *st = get_stream_state(cookie);
+        if (st)
+            __sync_fetch_and_add(&st->resyncs, 1);
+        update_metric(METRIC_ERRORS);
+        return skb->len;
+    }
+
+    __u64 length;
+    int len_bytes = tcp_parse_tlv_length(data, data_end, 1, &length);
+    if (len_bytes == 0)
+        return 0;          // Header spans a segment boundary - wait
+    if (len_bytes < 0 || length > TCP_MAX_TLV_LEN) {
+        update_metric(METRIC_ERRORS);
+        return skb->len;   // Unframeable - flush and resync
+    }
+
+    return 1 + len_bytes + length;
+}
+
+// Stream verdict: runs on one complete TLV. Hash the Interest name the
+// same way the XDP path does, probe the shared content store, and
+// record the result in per-socket state for the loader's serve thread.
+// Everything is passed up - the socket owner (the loader's TCP server)
+// reads the framed message either way, but a flagged hit costs it one
+// map lookup and a write instead of a trip through forwarder logic.
+SEC("sk_skb/stream_verdict")
+int ndn_tcp_stream_verdict(struct __sk_buff *skb)
+{
+    __u64 cookie = bpf_get_socket_cookie(skb);
+    struct tcp_stream_state *st = get_stream_state(cookie);
+
+    if (st)
+        __sync_fetch_and_add(&st->msgs_framed, 1);
+
+    // Linearize the head of the message: outer header plus Name
+    __u32 pull = skb->len < TCP_PARSE_PULL ? skb->len : TCP_PARSE_PULL;
+    bpf_skb_pull_data(skb, pull);
+
+    __u8 *data = (__u8 *)(long)skb->data;
+    __u8 *data_end = (__u8 *)(long)skb->data_end;
+
+    if (data + 1 > data_end)
+        return SK_PASS;
+
+    __u8 type = data[0];
+    if (type == NDN_DATA) {
+        // Data over TCP is consumed by the socket owner; caching it
+        // would mean copying the payload out of the skb here, which
+        // the userspace path already does with the CS map fd in hand
+        update_metric(METRIC_DATA_RECV);
+        return SK_PASS;
+    }
+    if (type != NDN_INTEREST) {
+        update_metric(METRIC_NACKS_RECV);
+        return SK_PASS;
+    }
+
+    update_metric(METRIC_INTERESTS_RECV);
+    if (st)
+        st->pending_hit = 0;
+
+    // Skip the outer TLV length to reach the Name TLV
+    __u64 outer_len;
+    int len_bytes = tcp_parse_tlv_length(data, data_end, 1, &outer_len);
+    if (len_bytes <= 0)
+        return SK_PASS;
+
+    __u32 offset = 1 + len_bytes;
+
+    // Name TLV type must come first inside an Interest
+    if (data + offset + 1 > data_end)
+        return SK_PASS;
+    if (data[offset] != NDN_TLV_NAME)
+        return SK_PASS;
+
+    __u64 name_len;
+    len_bytes = tcp_parse_tlv_length(data, data_end, offset + 1, &name_len);
+    if (len_bytes <= 0)
+        return SK_PASS;
+
+    // Full Name TLV size including its own type and length fields,
+    // matching what the XDP path stores in cs_entry_v2.name_len
+    __u32 name_size = 1 + len_bytes + name_len;
+    __u8 *name_value = data + offset + 1 + len_bytes;
+
+    if (name_value + name_len > data_end)
+        return SK_PASS;
+
+    __u64 name_hash = skb_xxhash(name_value, name_len, 0, data_end);
+
+    // Probe the shared content store, with the same collision check
+    // as the XDP path: stored name length and leading bytes must match
+    void *cs = cs_active();
+    struct cs_entry_v2 *entry = cs ? bpf_map_lookup_elem(cs, &name_hash) : NULL;
+
+    if (entry && entry->name_len == name_size) {
+        __u8 *name_tlv = data + offset;
+
+        #pragma unroll
+        for (int i = 0; i < CS_NAME_PREFIX_LEN; i++) {
+            if ((__u32)i >= name_size)
+                break;
+            if (name_tlv + i + 1 > data_end || name_tlv[i] != entry->name_prefix[i]) {
+                entry = NULL;
+                break;
+            }
+        }
+    } else {
+        entry = NULL;
+    }
+
+    if (entry && !content_expired(entry)) {
+        update_metric(METRIC_CACHE_HITS);
+        if (st) {
+            st->pending_hit = name_hash;
+            __sync_fetch_and_add(&st->cache_hits, 1);
+        }
+    } else {
+        update_metric(METRIC_CACHE_MISSES);
+        if (st)
+            __sync_fetch_and_add(&st->cache_misses, 1);
+    }
+
+    return SK_PASS;
+}
+
+// SK_MSG hook: accounts egress on NDN sockets, so the serve thread's
+// cache replies show up in the per-socket state next to the hits that
+// produced them. The sendmsg data is only observed, never copied.
+SEC("sk_msg")
+int ndn_tcp_sendmsg(struct sk_msg_md *msg)
+{
+    __u64 cookie = bpf_get_socket_cookie(msg->sk);
+    struct tcp_stream_state *st = get_stream_state(cookie);
+
+    if (st)
+        __sync_fetch_and_add(&st->bytes_tx, msg->size);
+
+    return SK_PASS;
+}
+
+char _license[] SEC("license") = "GPL";
@@ -39,6 +39,16 @@
 #define NDN_TLV_FRESHNESS_PERIOD    0x19
 #define NDN_TLV_FINAL_BLOCK_ID      0x1A
 
+// Network NACK reason, carried as the field after the Name in a
+// synthesized NACK frame. NDNLPv2 assigns NackReason type 801; it is
+// compressed into the one-byte type space this prototype parses.
+#define NDN_TLV_NACK_REASON         0x32
+
+// NackReason values (NDNLPv2 assigned numbers)
+#define NDN_NACK_CONGESTION         50   // Shed by the rate limiter
+#define NDN_NACK_DUPLICATE          100  // Duplicate nonce
+#define NDN_NACK_NO_ROUTE           150  // No forwarding state available
+
 // Content types
 #define NDN_CONTENT_TYPE_BLOB       0x00
 #define NDN_CONTENT_TYPE_LINK       0x01
@@ -71,12 +81,65 @@ struct cs_entry {
     __u8 data[0];        // Variable length data
 } __attribute__((packed));
 
+// FIB longest-prefix-match key
+// The data field carries the raw encoded name-component TLVs of a prefix,
+// so prefix boundaries stored in the trie always coincide with component
+// boundaries and a truncated lookup key can never match mid-component.
+#define FIB_LPM_MAX_PREFIX 64
+
+struct fib_lpm_key {
+    __u32 prefixlen;                // Prefix length in bits
+    __u8 data[FIB_LPM_MAX_PREFIX];  // Encoded name-component TLVs
+};
+
+// Processing latency histogram: log2 buckets of processing_time_ns
+// (bucket b counts samples in [2^b, 2^(b+1)) ns; shared with the loader)
+#define LATENCY_BUCKETS 32
+
+// Nonce bloom filter sizing (shared with the loader, which creates the
+// replacement generation maps on rotation)
+#define NONCE_BLOOM_ENTRIES  (1 << 21)  // ~2M nonces per generation
+#define NONCE_BLOOM_HASHES   3          // Hash functions per filter
+
 // Hash function types for NDN names
 #define HASH_ALGO_SIMPLE     0  // Simple XOR-based hash (for testing)
 #define HASH_ALGO_JENKINS    1  // Jenkins hash
 #define HASH_ALGO_MURMUR     2  // MurmurHash3
 #define HASH_ALGO_XXHASH     3  // xxHash
 
+// Tail-call pipeline stage indexes into the prog_stages jump table
+// (shared with the loader, which wires the table up after load)
+#define STAGE_CLASSIFY  0  // Ether/IP/UDP classification (attach point)
+#define STAGE_PARSE     1  // TLV parse + name hash
+#define STAGE_CS        2  // Content store lookup/serve or store
+#define STAGE_FORWARD   3  // Nonce dedup, PIT, forwarding decision
+#define STAGE_MAX       4
+
+// Ring buffer event types reported to userspace
+#define EVENT_INTEREST_PROCESSED     1
+#define EVENT_DATA_PROCESSED         2
+#define EVENT_CACHE_HIT              3
+#define EVENT_CONTENT_CACHED         4
+#define EVENT_DUPLICATE_INTEREST     5
+#define EVENT_UNSOLICITED_DATA       6
+#define EVENT_USERSPACE_FALLBACK     7
+#define EVENT_CACHE_HIT_CHUNKED      8
+#define EVENT_CONTENT_CACHED_CHUNKED 9
+#define EVENT_INTEREST_TIMEOUT       10
+
+// Build-time role specialization. Consumer-edge nodes see almost only
+// Interests and producer-edge nodes almost only Data, so the build can
+// drop the other half of the pipeline: smaller programs verify faster,
+// stay hotter in the instruction cache, and leave verifier budget for
+// the half that actually runs. 0 = full pipeline, 1 = Interest-only,
+// 2 = Data-only (set with -DNDN_BUILD_ROLE=n; see the ebpf_xdp
+// Makefile variant targets).
+#ifndef NDN_BUILD_ROLE
+#define NDN_BUILD_ROLE 0
+#endif
+#define NDN_ROLE_HANDLES_INTEREST (NDN_BUILD_ROLE != 2)
+#define NDN_ROLE_HANDLES_DATA     (NDN_BUILD_ROLE != 1)
+
 // NDN metrics counter indexes
 #define METRIC_INTERESTS_RECV    0
 #define METRIC_DATA_RECV         1
@@ -86,6 +149,11 @@ struct cs_entry {
 #define METRIC_REDIRECTS         5
 #define METRIC_DROPS             6
 #define METRIC_ERRORS            7
-#define METRIC_MAX               8  // Total number of metrics
+#define METRIC_CACHE_INSERTS     8
+#define METRIC_RATELIMITED       9
+#define METRIC_CS_ADMITTED       10
+#define METRIC_CS_BYPASSED       11
+#define METRIC_NACKS_SENT        12
+#define METRIC_MAX               13 // Total number of metrics
 
 #endif /* NDN_TLV_H */
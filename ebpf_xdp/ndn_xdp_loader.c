@@ -28,6 +28,9 @@
 // NDN TLV definitions
 #include "ndn_tlv.h"
 
+// Batched map syscall helpers shared with the v2 loader
+#include "ndn_map_batch.h"
+
 // Include auto-generated skeleton from the ndn_parser.c
 #include "ndn_parser.skel.h"
 
@@ -74,10 +77,54 @@ void print_usage(const char *prog) {
         "  -m              Disable metrics collection\n"
         "  -r INTERVAL     Reporting interval in seconds (default: 1)\n"
         "  -o OUTPUT       Output file for metrics (default: stdout)\n"
+        "  -F PREFIX=IF    Add LPM route: name prefix to egress interface\n"
+        "                  (repeatable, e.g. -F /com/example=eth1)\n"
+        "  -P DIR          Pin state maps under DIR (on bpffs) and leave the\n"
+        "                  XDP program attached on exit; a restarted loader\n"
+        "                  reattaches to the live tables instead of starting\n"
+        "                  empty (requires the same -c capacity)\n"
         "  -h              Display this help and exit\n",
         prog);
 }
 
+// Pin the state-bearing maps under a bpffs directory before load.
+// libbpf then reuses a compatible pinned map when one exists and
+// creates + pins it on first boot, so a loader restart reattaches to
+// the live content store, PIT, FIB, config and metrics instead of
+// recreating them empty. A restart must use the same capacity: a
+// pinned map of a different size is incompatible and load fails.
+int setup_map_pinning(struct ndn_parser_bpf *skel, const char *pin_dir) {
+    struct bpf_map *pin_maps[] = {
+        skel->maps.content_store,
+        skel->maps.pit,
+        skel->maps.fib,
+        skel->maps.fib_lpm,
+        skel->maps.config,
+        skel->maps.metrics,
+    };
+    int num_pin_maps = sizeof(pin_maps) / sizeof(pin_maps[0]);
+    char path[256];
+    int i;
+
+    if (mkdir(pin_dir, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create pin directory '%s': %s\n",
+                pin_dir, strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < num_pin_maps; i++) {
+        snprintf(path, sizeof(path), "%s/%s", pin_dir,
+                 bpf_map__name(pin_maps[i]));
+        if (bpf_map__set_pin_path(pin_maps[i], path) != 0) {
+            fprintf(stderr, "Error: Could not set pin path '%s': %s\n",
+                    path, strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 // Update XDP program configuration
 int update_config(int config_fd) {
     __u32 key = 0;
@@ -89,42 +136,106 @@ int init_fib(int fib_fd, int ifindex) {
     // Default catch-all route - just an example
     __u64 default_prefix = 0xFFFFFFFFFFFFFFFF;
     __u32 output_if = ifindex;
-    
+
     return bpf_map_update_elem(fib_fd, &default_prefix, &output_if, BPF_ANY);
 }
 
+// Encode a URI-style name prefix (e.g. "/com/example") into the raw
+// name-component TLV form used as LPM trie key material. Returns the
+// number of encoded bytes, or -1 if the prefix doesn't fit.
+int encode_name_prefix(const char *uri, __u8 *buf, size_t buf_size) {
+    size_t offset = 0;
+    const char *p = uri;
+
+    if (*p == '/')
+        p++; // Skip leading slash
+
+    while (*p) {
+        const char *component_start = p;
+
+        // Find the end of this component
+        while (*p && *p != '/')
+            p++;
+
+        size_t component_len = p - component_start;
+        if (component_len > 0) {
+            // Component TLV: type, length, value (short form only)
+            if (component_len > 252 || offset + 2 + component_len > buf_size)
+                return -1;
+
+            buf[offset++] = NDN_TLV_NAME_COMPONENT;
+            buf[offset++] = (__u8)component_len;
+            memcpy(buf + offset, component_start, component_len);
+            offset += component_len;
+        }
+
+        // Skip the slash
+        if (*p == '/')
+            p++;
+    }
+
+    return (int)offset;
+}
+
+// Add a longest-prefix-match route: name prefix -> egress interface
+int fib_lpm_add_route(int fib_lpm_fd, const char *prefix_uri, __u32 egress_ifindex) {
+    struct fib_lpm_key key = {0};
+    int encoded_len;
+
+    encoded_len = encode_name_prefix(prefix_uri, key.data, sizeof(key.data));
+    if (encoded_len <= 0) {
+        fprintf(stderr, "Error: Could not encode prefix '%s' (max %d bytes)\n",
+                prefix_uri, FIB_LPM_MAX_PREFIX);
+        return -1;
+    }
+
+    key.prefixlen = encoded_len * 8;
+
+    if (bpf_map_update_elem(fib_lpm_fd, &key, &egress_ifindex, BPF_ANY) != 0) {
+        fprintf(stderr, "Error: Failed to insert route for '%s': %s\n",
+                prefix_uri, strerror(errno));
+        return -1;
+    }
+
+    printf("FIB route added: %s -> ifindex %u\n", prefix_uri, egress_ifindex);
+    return 0;
+}
+
+// Remove a longest-prefix-match route
+int fib_lpm_del_route(int fib_lpm_fd, const char *prefix_uri) {
+    struct fib_lpm_key key = {0};
+    int encoded_len;
+
+    encoded_len = encode_name_prefix(prefix_uri, key.data, sizeof(key.data));
+    if (encoded_len <= 0)
+        return -1;
+
+    key.prefixlen = encoded_len * 8;
+
+    return bpf_map_delete_elem(fib_lpm_fd, &key);
+}
+
 // Collect metrics from the XDP program
+// One BPF_MAP_LOOKUP_BATCH syscall fetches all per-CPU counters at once
 int collect_metrics(int metrics_fd, struct metrics_data *data) {
-    __u32 key;
-    __u64 values[4] = {0}; // 4 CPUs max for this example
-    __u64 sum;
-    
-    // Collect each metric
-    for (key = 0; key < METRIC_MAX; key++) {
-        if (bpf_map_lookup_elem(metrics_fd, &key, values) != 0) {
-            fprintf(stderr, "Error looking up metric %d\n", key);
-            continue;
-        }
-        
-        // Sum up per-CPU values
-        sum = 0;
-        for (int i = 0; i < 4; i++) {
-            sum += values[i];
-        }
-        
-        // Store in the appropriate metric field
-        switch (key) {
-            case METRIC_INTERESTS_RECV: data->interests_recv = sum; break;
-            case METRIC_DATA_RECV: data->data_recv = sum; break;
-            case METRIC_NACKS_RECV: data->nacks_recv = sum; break;
-            case METRIC_CACHE_HITS: data->cache_hits = sum; break;
-            case METRIC_CACHE_MISSES: data->cache_misses = sum; break;
-            case METRIC_REDIRECTS: data->redirects = sum; break;
-            case METRIC_DROPS: data->drops = sum; break;
-            case METRIC_ERRORS: data->errors = sum; break;
-        }
+    __u64 sums[METRIC_MAX];
+    int err;
+
+    err = ndn_percpu_metrics_collect(metrics_fd, sums, METRIC_MAX);
+    if (err != 0) {
+        fprintf(stderr, "Error collecting metrics: %s\n", strerror(-err));
+        return -1;
     }
-    
+
+    data->interests_recv = sums[METRIC_INTERESTS_RECV];
+    data->data_recv = sums[METRIC_DATA_RECV];
+    data->nacks_recv = sums[METRIC_NACKS_RECV];
+    data->cache_hits = sums[METRIC_CACHE_HITS];
+    data->cache_misses = sums[METRIC_CACHE_MISSES];
+    data->redirects = sums[METRIC_REDIRECTS];
+    data->drops = sums[METRIC_DROPS];
+    data->errors = sums[METRIC_ERRORS];
+
     return 0;
 }
 
@@ -159,6 +270,7 @@ int main(int argc, char **argv) {
     int err, i, opt;
     char *ifname = NULL;
     char *output_file = NULL;
+    char *pin_dir = NULL;
     int ifindex;
     int xdp_flags = XDP_FLAGS_DRV_MODE;
     int metrics_interval = 1; // Default reporting interval (seconds)
@@ -166,10 +278,15 @@ int main(int argc, char **argv) {
     int cs_capacity = 10240; // Default content store capacity
     
     // Map file descriptors
-    int metrics_fd, config_fd, cs_fd, fib_fd, pit_fd;
+    int metrics_fd, config_fd, cs_fd, fib_fd, fib_lpm_fd, pit_fd;
+    
+    // Static LPM routes collected from the command line, applied after load
+    #define MAX_STATIC_ROUTES 32
+    char *static_routes[MAX_STATIC_ROUTES];
+    int num_static_routes = 0;
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "i:Sc:t:a:dpmr:o:h")) != -1) {
+    while ((opt = getopt(argc, argv, "i:Sc:t:a:dpmr:o:F:P:h")) != -1) {
         switch (opt) {
         case 'i':
             ifname = optarg;
@@ -201,6 +318,16 @@ int main(int argc, char **argv) {
         case 'o':
             output_file = optarg;
             break;
+        case 'F':
+            if (num_static_routes >= MAX_STATIC_ROUTES) {
+                fprintf(stderr, "Error: Too many routes (max %d)\n", MAX_STATIC_ROUTES);
+                return 1;
+            }
+            static_routes[num_static_routes++] = optarg;
+            break;
+        case 'P':
+            pin_dir = optarg;
+            break;
         case 'h':
             print_usage(argv[0]);
             return 0;
@@ -273,7 +400,14 @@ int main(int argc, char **argv) {
     
     // Customize map sizes based on command line options
     bpf_map__set_max_entries(skel->maps.content_store, cs_capacity);
-    
+
+    // Reattach to pinned state maps (or create and pin them on first
+    // boot) so restarts don't lose the cache, PIT, FIB or counters
+    if (pin_dir && setup_map_pinning(skel, pin_dir) != 0) {
+        fprintf(stderr, "Warning: Map pinning setup failed, continuing unpinned\n");
+        pin_dir = NULL;
+    }
+
     // Load BPF program
     err = ndn_parser_bpf__load(skel);
     if (err) {
@@ -286,9 +420,11 @@ int main(int argc, char **argv) {
     config_fd = bpf_map__fd(skel->maps.config);
     cs_fd = bpf_map__fd(skel->maps.content_store);
     fib_fd = bpf_map__fd(skel->maps.fib);
+    fib_lpm_fd = bpf_map__fd(skel->maps.fib_lpm);
     pit_fd = bpf_map__fd(skel->maps.pit);
     
-    if (metrics_fd < 0 || config_fd < 0 || cs_fd < 0 || fib_fd < 0 || pit_fd < 0) {
+    if (metrics_fd < 0 || config_fd < 0 || cs_fd < 0 || fib_fd < 0 ||
+        fib_lpm_fd < 0 || pit_fd < 0) {
         fprintf(stderr, "Error: Failed to get file descriptors for maps\n");
         goto cleanup;
     }
@@ -303,6 +439,26 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Warning: Failed to initialize FIB\n");
     }
     
+    // Install static prefix routes from the command line
+    for (i = 0; i < num_static_routes; i++) {
+        char *sep = strchr(static_routes[i], '=');
+        if (!sep) {
+            fprintf(stderr, "Warning: Ignoring malformed route '%s' (expected PREFIX=IF)\n",
+                    static_routes[i]);
+            continue;
+        }
+        *sep = '\0';
+        
+        __u32 egress = if_nametoindex(sep + 1);
+        if (!egress) {
+            fprintf(stderr, "Warning: Unknown egress interface '%s' for route '%s'\n",
+                    sep + 1, static_routes[i]);
+            continue;
+        }
+        
+        fib_lpm_add_route(fib_lpm_fd, static_routes[i], egress);
+    }
+    
     // Attach XDP program to interface
     err = bpf_set_link_xdp_fd(ifindex, bpf_program__fd(skel->progs.ndn_xdp_parser), xdp_flags);
     if (err) {
@@ -319,6 +475,7 @@ int main(int argc, char **argv) {
     printf("  PIT: %s\n", program_config.pit_enabled ? "Enabled" : "Disabled");
     printf("  Metrics: %s\n", program_config.metrics_enabled ? "Enabled" : "Disabled");
     printf("  Hash Algorithm: %d\n", program_config.hash_algorithm);
+    printf("  State pinning: %s\n", pin_dir ? pin_dir : "Disabled");
     printf("Press Ctrl+C to exit and detach program\n\n");
     
     // Main loop: periodically collect and print metrics
@@ -335,10 +492,18 @@ int main(int argc, char **argv) {
         sleep(metrics_interval);
     }
     
-    // Detach XDP program and cleanup
-    bpf_set_link_xdp_fd(ifindex, -1, xdp_flags);
-    printf("\nDetached XDP program from %s\n", ifname);
-    
+    // With pinned state the program stays attached: the kernel keeps it
+    // (and the pinned maps keep the state) alive while the loader is
+    // down, so a restart costs no cache and no forwarding downtime
+    if (pin_dir) {
+        printf("\nLeaving XDP program attached on %s; state pinned under %s\n",
+               ifname, pin_dir);
+    } else {
+        // Detach XDP program and cleanup
+        bpf_set_link_xdp_fd(ifindex, -1, xdp_flags);
+        printf("\nDetached XDP program from %s\n", ifname);
+    }
+
     // Cleanup resources
     cleanup:
     ndn_parser_bpf__destroy(skel);